@@ -0,0 +1,384 @@
+/**
+ * @file        dense_heads.c
+ * @brief       Evaluate many keras Dense heads on the host over one shared backbone feature
+ * @version     0.1
+ * @date        2026-10-19
+ *
+ * All heads are concatenated into one in_dim x out_stride weight matrix, packed once at load time
+ * into panels of DH_NR columns (panel p holds rows k = 0..in_dim-1, DH_NR floats each, contiguous).
+ * dense_heads_run() walks K in DH_KC blocks so one panel slice (DH_KC x DH_NR floats) stays in L1
+ * while every DH_MR-row tile of the batch streams past it.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dense_heads.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define DH_USE_AVX2
+#define DH_NR           16
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define DH_USE_SSE
+#define DH_NR           8
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DH_USE_NEON
+#define DH_NR           8
+#else
+#define DH_NR           8
+#endif
+
+#define DH_MR           4
+#define DH_KC           256
+#define DH_ALIGN        64
+#define DH_MAGIC        "KLHD"
+#define DH_VERSION      1
+#define DH_HEADS_MAX    1024
+
+#if defined(__GNUC__)
+#define DH_INLINE       static inline __attribute__((always_inline))
+#else
+#define DH_INLINE       static inline
+#endif
+
+struct dense_heads_s {
+    int in_dim;
+    int head_count;
+    int total_out;
+    int panels;
+    struct dense_head_info_s *info;
+    float *packed;          /* panels x in_dim x DH_NR */
+    float *bias;            /* panels x DH_NR */
+};
+
+/* One DH_MR x DH_NR tile of y += x[:, k0:k0+kc] . W[k0:k0+kc, panel], only the first mr rows.
+ * first: start from the bias instead of what y holds. */
+#if defined(DH_USE_AVX2)
+
+DH_INLINE void dh_tile(const float *x, int in_dim, const float *w, int kc, const float *bias,
+                       float *y, int y_stride, int mr, int first)
+{
+    __m256 c[DH_MR][2];
+    int r, k;
+
+    for (r = 0; r < DH_MR; r++) {
+        if (r < mr) {
+            c[r][0] = _mm256_loadu_ps(first ? bias : y + r * y_stride);
+            c[r][1] = _mm256_loadu_ps(first ? bias + 8 : y + r * y_stride + 8);
+        }
+    }
+
+    for (k = 0; k < kc; k++) {
+        __m256 b0 = _mm256_load_ps(w + k * DH_NR);
+        __m256 b1 = _mm256_load_ps(w + k * DH_NR + 8);
+
+        for (r = 0; r < DH_MR; r++) {
+            if (r < mr) {
+                __m256 a = _mm256_broadcast_ss(x + r * in_dim + k);
+                c[r][0] = _mm256_fmadd_ps(a, b0, c[r][0]);
+                c[r][1] = _mm256_fmadd_ps(a, b1, c[r][1]);
+            }
+        }
+    }
+
+    for (r = 0; r < DH_MR; r++) {
+        if (r < mr) {
+            _mm256_storeu_ps(y + r * y_stride, c[r][0]);
+            _mm256_storeu_ps(y + r * y_stride + 8, c[r][1]);
+        }
+    }
+}
+
+const char *dense_heads_isa(void)
+{
+    return "avx2";
+}
+
+#elif defined(DH_USE_SSE) || defined(DH_USE_NEON)
+
+#if defined(DH_USE_SSE)
+typedef __m128 dh_v4;
+#define DH_LOAD(p)          _mm_load_ps(p)
+#define DH_LOADU(p)         _mm_loadu_ps(p)
+#define DH_STOREU(p, v)     _mm_storeu_ps(p, v)
+#define DH_DUP(p)           _mm_set1_ps(*(p))
+#define DH_FMA(a, b, c)     _mm_add_ps(_mm_mul_ps(a, b), c)
+#else
+typedef float32x4_t dh_v4;
+#define DH_LOAD(p)          vld1q_f32(p)
+#define DH_LOADU(p)         vld1q_f32(p)
+#define DH_STOREU(p, v)     vst1q_f32(p, v)
+#define DH_DUP(p)           vld1q_dup_f32(p)
+#if defined(__aarch64__)
+#define DH_FMA(a, b, c)     vfmaq_f32(c, a, b)
+#else
+#define DH_FMA(a, b, c)     vmlaq_f32(c, a, b)
+#endif
+#endif
+
+DH_INLINE void dh_tile(const float *x, int in_dim, const float *w, int kc, const float *bias,
+                       float *y, int y_stride, int mr, int first)
+{
+    dh_v4 c[DH_MR][2];
+    int r, k;
+
+    for (r = 0; r < DH_MR; r++) {
+        if (r < mr) {
+            c[r][0] = DH_LOADU(first ? bias : y + r * y_stride);
+            c[r][1] = DH_LOADU(first ? bias + 4 : y + r * y_stride + 4);
+        }
+    }
+
+    for (k = 0; k < kc; k++) {
+        dh_v4 b0 = DH_LOAD(w + k * DH_NR);
+        dh_v4 b1 = DH_LOAD(w + k * DH_NR + 4);
+
+        for (r = 0; r < DH_MR; r++) {
+            if (r < mr) {
+                dh_v4 a = DH_DUP(x + r * in_dim + k);
+                c[r][0] = DH_FMA(a, b0, c[r][0]);
+                c[r][1] = DH_FMA(a, b1, c[r][1]);
+            }
+        }
+    }
+
+    for (r = 0; r < DH_MR; r++) {
+        if (r < mr) {
+            DH_STOREU(y + r * y_stride, c[r][0]);
+            DH_STOREU(y + r * y_stride + 4, c[r][1]);
+        }
+    }
+}
+
+const char *dense_heads_isa(void)
+{
+#if defined(DH_USE_SSE)
+    return "sse";
+#else
+    return "neon";
+#endif
+}
+
+#else
+
+DH_INLINE void dh_tile(const float *x, int in_dim, const float *w, int kc, const float *bias,
+                       float *y, int y_stride, int mr, int first)
+{
+    float c[DH_MR][DH_NR];
+    int r, k, j;
+
+    for (r = 0; r < mr; r++) {
+        for (j = 0; j < DH_NR; j++)
+            c[r][j] = first ? bias[j] : y[r * y_stride + j];
+    }
+
+    for (k = 0; k < kc; k++) {
+        for (r = 0; r < mr; r++) {
+            float a = x[r * in_dim + k];
+            for (j = 0; j < DH_NR; j++)
+                c[r][j] += a * w[k * DH_NR + j];
+        }
+    }
+
+    for (r = 0; r < mr; r++) {
+        for (j = 0; j < DH_NR; j++)
+            y[r * y_stride + j] = c[r][j];
+    }
+}
+
+const char *dense_heads_isa(void)
+{
+    return "scalar";
+}
+
+#endif
+
+static void softmax(float *v, int n)
+{
+    float m = v[0], sum = 0;
+    int i;
+
+    for (i = 1; i < n; i++) {
+        if (v[i] > m)
+            m = v[i];
+    }
+    for (i = 0; i < n; i++) {
+        v[i] = expf(v[i] - m);
+        sum += v[i];
+    }
+    for (i = 0; i < n; i++)
+        v[i] /= sum;
+}
+
+void dense_heads_run(const struct dense_heads_s *dh, const float *x, int batch, float *y)
+{
+    int y_stride = dh->panels * DH_NR;
+    int k0, kc, p, i, h, j;
+
+    for (k0 = 0; k0 < dh->in_dim; k0 += DH_KC) {
+        kc = dh->in_dim - k0 < DH_KC ? dh->in_dim - k0 : DH_KC;
+
+        for (p = 0; p < dh->panels; p++) {
+            const float *w = dh->packed + ((size_t)p * dh->in_dim + k0) * DH_NR;
+            const float *bias = dh->bias + p * DH_NR;
+
+            for (i = 0; i + DH_MR <= batch; i += DH_MR)
+                dh_tile(x + (size_t)i * dh->in_dim + k0, dh->in_dim, w, kc, bias,
+                        y + (size_t)i * y_stride + p * DH_NR, y_stride, DH_MR, k0 == 0);
+
+            switch (batch - i) {
+            case 3: dh_tile(x + (size_t)i * dh->in_dim + k0, dh->in_dim, w, kc, bias,
+                            y + (size_t)i * y_stride + p * DH_NR, y_stride, 3, k0 == 0); break;
+            case 2: dh_tile(x + (size_t)i * dh->in_dim + k0, dh->in_dim, w, kc, bias,
+                            y + (size_t)i * y_stride + p * DH_NR, y_stride, 2, k0 == 0); break;
+            case 1: dh_tile(x + (size_t)i * dh->in_dim + k0, dh->in_dim, w, kc, bias,
+                            y + (size_t)i * y_stride + p * DH_NR, y_stride, 1, k0 == 0); break;
+            default: break;
+            }
+        }
+    }
+
+    for (h = 0; h < dh->head_count; h++) {
+        const struct dense_head_info_s *info = &dh->info[h];
+
+        for (i = 0; i < batch; i++) {
+            float *v = y + (size_t)i * y_stride + info->offset;
+
+            if (info->activation == DENSE_ACT_SOFTMAX) {
+                softmax(v, info->out_dim);
+            } else if (info->activation == DENSE_ACT_SIGMOID) {
+                for (j = 0; j < info->out_dim; j++)
+                    v[j] = 1 / (1 + expf(-v[j]));
+            }
+        }
+    }
+}
+
+static int read_u32(FILE *fp, uint32_t *v)
+{
+    return fread(v, sizeof(uint32_t), 1, fp) == 1 ? 0 : -1;
+}
+
+struct dense_heads_s *dense_heads_load(const char *path)
+{
+    struct dense_heads_s *dh = NULL;
+    uint32_t version, head_count, in_dim, out_dim, activation;
+    char magic[4], name[DENSE_HEADS_NAME_LEN];
+    float *kernel = NULL;
+    long heads_pos;
+    int total = 0, h, k, j, col;
+    FILE *fp;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        printf("could not open heads file '%s'\n", path);
+        return NULL;
+    }
+
+    if (fread(magic, 1, 4, fp) != 4 || memcmp(magic, DH_MAGIC, 4) != 0 ||
+        read_u32(fp, &version) || version != DH_VERSION ||
+        read_u32(fp, &head_count) || head_count == 0 || head_count > DH_HEADS_MAX ||
+        read_u32(fp, &in_dim) || in_dim == 0 || in_dim > (1 << 20)) {
+        printf("'%s' is not a version %d heads file\n", path, DH_VERSION);
+        goto fail;
+    }
+
+    dh = (struct dense_heads_s *)calloc(1, sizeof(struct dense_heads_s));
+    if (dh == NULL)
+        goto fail;
+    dh->in_dim = in_dim;
+    dh->head_count = head_count;
+    dh->info = (struct dense_head_info_s *)calloc(head_count, sizeof(struct dense_head_info_s));
+    if (dh->info == NULL)
+        goto fail;
+
+    /* first pass: shapes, so the packed matrix can be allocated once */
+    heads_pos = ftell(fp);
+    for (h = 0; h < (int)head_count; h++) {
+        if (read_u32(fp, &out_dim) || out_dim == 0 || out_dim > (1 << 16) || read_u32(fp, &activation) ||
+            activation > DENSE_ACT_SIGMOID || fread(name, 1, sizeof(name), fp) != sizeof(name) ||
+            fseek(fp, ((long)in_dim + 1) * out_dim * sizeof(float), SEEK_CUR) != 0) {
+            printf("'%s': head %d is truncated\n", path, h);
+            goto fail;
+        }
+        memcpy(dh->info[h].name, name, sizeof(name));
+        dh->info[h].name[DENSE_HEADS_NAME_LEN - 1] = 0;
+        dh->info[h].out_dim = out_dim;
+        dh->info[h].activation = activation;
+        dh->info[h].offset = total;
+        total += out_dim;
+    }
+
+    dh->total_out = total;
+    dh->panels = (total + DH_NR - 1) / DH_NR;
+    if (posix_memalign((void **)&dh->packed, DH_ALIGN, (size_t)dh->panels * in_dim * DH_NR * sizeof(float)) ||
+        posix_memalign((void **)&dh->bias, DH_ALIGN, (size_t)dh->panels * DH_NR * sizeof(float)))
+        goto fail;
+    memset(dh->packed, 0, (size_t)dh->panels * in_dim * DH_NR * sizeof(float));
+    memset(dh->bias, 0, (size_t)dh->panels * DH_NR * sizeof(float));
+
+    /* second pass: pack */
+    fseek(fp, heads_pos, SEEK_SET);
+    for (h = 0; h < (int)head_count; h++) {
+        out_dim = dh->info[h].out_dim;
+        kernel = (float *)malloc(((size_t)in_dim + 1) * out_dim * sizeof(float));
+        if (kernel == NULL)
+            goto fail;
+        fseek(fp, 2 * sizeof(uint32_t) + DENSE_HEADS_NAME_LEN, SEEK_CUR);
+        if (fread(kernel, sizeof(float), ((size_t)in_dim + 1) * out_dim, fp) != ((size_t)in_dim + 1) * out_dim)
+            goto fail;
+
+        for (j = 0; j < (int)out_dim; j++) {
+            col = dh->info[h].offset + j;
+            for (k = 0; k < (int)in_dim; k++)
+                dh->packed[((size_t)(col / DH_NR) * in_dim + k) * DH_NR + col % DH_NR] = kernel[(size_t)k * out_dim + j];
+            dh->bias[col] = kernel[(size_t)in_dim * out_dim + j];
+        }
+        free(kernel);
+        kernel = NULL;
+    }
+
+    fclose(fp);
+    return dh;
+
+fail:
+    free(kernel);
+    dense_heads_free(dh);
+    fclose(fp);
+    return NULL;
+}
+
+void dense_heads_free(struct dense_heads_s *dh)
+{
+    if (dh == NULL)
+        return;
+    free(dh->info);
+    free(dh->packed);
+    free(dh->bias);
+    free(dh);
+}
+
+int dense_heads_in_dim(const struct dense_heads_s *dh)
+{
+    return dh->in_dim;
+}
+
+int dense_heads_count(const struct dense_heads_s *dh)
+{
+    return dh->head_count;
+}
+
+const struct dense_head_info_s *dense_heads_info(const struct dense_heads_s *dh, int head)
+{
+    return &dh->info[head];
+}
+
+int dense_heads_out_stride(const struct dense_heads_s *dh)
+{
+    return dh->panels * DH_NR;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file        dense_heads.h
+ * @brief       Evaluate many keras Dense heads on the host over one shared backbone feature
+ * @version     0.1
+ * @date        2026-10-19
+ *
+ * Head file (little endian, written by Python_validation/export_heads.py):
+ *
+ *   "KLHD" | u32 version (1) | u32 head_count | u32 in_dim
+ *   head_count x { u32 out_dim | u32 activation | char name[32] |
+ *                  f32 kernel[in_dim][out_dim] (keras layout) | f32 bias[out_dim] }
+ */
+
+#ifndef __DENSE_HEADS_H__
+#define __DENSE_HEADS_H__
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+#define DENSE_HEADS_NAME_LEN    32
+
+enum dense_head_act_e {
+    DENSE_ACT_NONE = 0,
+    DENSE_ACT_SOFTMAX,
+    DENSE_ACT_SIGMOID,
+};
+
+struct dense_head_info_s {
+    char name[DENSE_HEADS_NAME_LEN];
+    int out_dim;
+    int activation;         /* enum dense_head_act_e */
+    int offset;             /* first column of this head in every output row */
+};
+
+struct dense_heads_s;
+
+/* NULL if the file is missing or malformed */
+struct dense_heads_s *dense_heads_load(const char *path);
+void dense_heads_free(struct dense_heads_s *dh);
+
+int dense_heads_in_dim(const struct dense_heads_s *dh);
+int dense_heads_count(const struct dense_heads_s *dh);
+const struct dense_head_info_s *dense_heads_info(const struct dense_heads_s *dh, int head);
+
+/* Floats per output row: all heads back to back, padded to the kernel panel width */
+int dense_heads_out_stride(const struct dense_heads_s *dh);
+
+/* y[b * out_stride + info->offset + j] = act(x[b * in_dim + :] . W_head[:, j] + bias_head[j])
+ * for every head, as one packed GEMM over the whole batch */
+void dense_heads_run(const struct dense_heads_s *dh, const float *x, int batch, float *y);
+
+/* Name of the kernel compiled in: "avx2", "sse", "neon" or "scalar" */
+const char *dense_heads_isa(void);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif
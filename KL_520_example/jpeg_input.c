@@ -0,0 +1,194 @@
+/**
+ * @file        jpeg_input.c
+ * @brief       Decode JPEG inputs at the smallest DCT scale that still covers the model input
+ * @version     0.1
+ * @date        2026-10-19
+ */
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <jpeglib.h>
+#include "jpeg_input.h"
+
+struct jpeg_input_err_s {
+    struct jpeg_error_mgr pub;
+    jmp_buf jmp;
+};
+
+struct jpeg_input_tls_s {
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_input_err_s err;
+    uint8_t *buf;
+    size_t cap;
+};
+
+static __thread struct jpeg_input_tls_s *tls;
+
+static void err_exit(j_common_ptr cinfo)
+{
+    struct jpeg_input_err_s *err = (struct jpeg_input_err_s *)cinfo->err;
+
+    longjmp(err->jmp, 1);
+}
+
+static void err_silent(j_common_ptr cinfo)
+{
+    (void)cinfo;
+}
+
+static struct jpeg_input_tls_s *get_tls(void)
+{
+    if (tls != NULL)
+        return tls;
+
+    tls = (struct jpeg_input_tls_s *)calloc(1, sizeof(struct jpeg_input_tls_s));
+    if (tls == NULL)
+        return NULL;
+    tls->cinfo.err = jpeg_std_error(&tls->err.pub);
+    tls->err.pub.error_exit = err_exit;
+    tls->err.pub.output_message = err_silent;
+    jpeg_create_decompress(&tls->cinfo);
+    return tls;
+}
+
+static int is_jpeg(FILE *fp)
+{
+    unsigned char magic[3];
+    int ret;
+
+    ret = fread(magic, 1, 3, fp) == 3 && magic[0] == 0xff && magic[1] == 0xd8 && magic[2] == 0xff;
+    rewind(fp);
+    return ret;
+}
+
+/* Scale steps in eighths, smallest first. libjpeg-turbo could also do 3/8, 5/8, ... but only the
+ * power of two reductions have SIMD IDCTs; the others measured slower than a full size decode. */
+static const int scale_steps[] = { 1, 2, 4, 8 };
+
+/* Reads from fp, or from data / len when fp is NULL; name is only for the error message */
+static const uint8_t *decode(struct jpeg_input_tls_s *t, FILE *fp, const uint8_t *data, size_t len, const char *name,
+                             int min_w, int min_h, int *width, int *height, int *scale)
+{
+    struct jpeg_decompress_struct *cinfo = &t->cinfo;
+    size_t stride, need;
+    JSAMPROW row;
+    int i;
+
+    if (setjmp(t->err.jmp)) {
+        char msg[JMSG_LENGTH_MAX];
+
+        t->err.pub.format_message((j_common_ptr)cinfo, msg);
+        printf("jpeg decode of '%s' failed: %s\n", name, msg);
+        jpeg_abort_decompress(cinfo);
+        return NULL;
+    }
+
+    if (fp != NULL)
+        jpeg_stdio_src(cinfo, fp);
+    else
+        jpeg_mem_src(cinfo, (unsigned char *)data, len);
+    jpeg_read_header(cinfo, TRUE);
+
+    if (cinfo->jpeg_color_space != JCS_GRAYSCALE && cinfo->jpeg_color_space != JCS_YCbCr &&
+        cinfo->jpeg_color_space != JCS_RGB) {
+        /* CMYK / YCCK: leave those to the generic loader */
+        jpeg_abort_decompress(cinfo);
+        return NULL;
+    }
+#if defined(JCS_EXTENSIONS)
+    cinfo->out_color_space = JCS_EXT_BGR;
+#else
+    cinfo->out_color_space = JCS_RGB;
+#endif
+
+    /* smallest output that still covers min_w x min_h */
+    cinfo->scale_denom = 8;
+    for (i = 0; i < (int)(sizeof(scale_steps) / sizeof(scale_steps[0])); i++) {
+        cinfo->scale_num = scale_steps[i];
+        jpeg_calc_output_dimensions(cinfo);
+        if ((int)cinfo->output_width >= min_w && (int)cinfo->output_height >= min_h)
+            break;
+    }
+    if (i == (int)(sizeof(scale_steps) / sizeof(scale_steps[0])))
+        cinfo->scale_num = 8;
+
+    jpeg_start_decompress(cinfo);
+
+    stride = (size_t)cinfo->output_width * 3;
+    need = stride * cinfo->output_height;
+    if (need > t->cap) {
+        uint8_t *buf = (uint8_t *)realloc(t->buf, need);
+
+        if (buf == NULL) {
+            jpeg_abort_decompress(cinfo);
+            return NULL;
+        }
+        t->buf = buf;
+        t->cap = need;
+    }
+
+    while (cinfo->output_scanline < cinfo->output_height) {
+        row = t->buf + stride * cinfo->output_scanline;
+        jpeg_read_scanlines(cinfo, &row, 1);
+    }
+
+#if !defined(JCS_EXTENSIONS)
+    {
+        uint8_t *p, tmp;
+
+        for (p = t->buf; p < t->buf + need; p += 3) {
+            tmp = p[0];
+            p[0] = p[2];
+            p[2] = tmp;
+        }
+    }
+#endif
+
+    *width = cinfo->output_width;
+    *height = cinfo->output_height;
+    if (scale != NULL)
+        *scale = cinfo->scale_num;
+
+    jpeg_finish_decompress(cinfo);
+    return t->buf;
+}
+
+const uint8_t *jpeg_input_decode(const char *path, int min_w, int min_h, int *width, int *height, int *scale)
+{
+    struct jpeg_input_tls_s *t;
+    const uint8_t *ret = NULL;
+    FILE *fp;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL)
+        return NULL;
+    if (is_jpeg(fp) && (t = get_tls()) != NULL)
+        ret = decode(t, fp, NULL, 0, path, min_w, min_h, width, height, scale);
+    fclose(fp);
+    return ret;
+}
+
+const uint8_t *jpeg_input_decode_mem(const uint8_t *data, size_t len, int min_w, int min_h, int *width, int *height,
+                                     int *scale)
+{
+    struct jpeg_input_tls_s *t;
+
+    if (len < 3 || data[0] != 0xff || data[1] != 0xd8 || data[2] != 0xff)
+        return NULL;
+    t = get_tls();
+    if (t == NULL)
+        return NULL;
+    return decode(t, NULL, data, len, "<memory>", min_w, min_h, width, height, scale);
+}
+
+void jpeg_input_release(void)
+{
+    if (tls == NULL)
+        return;
+    jpeg_destroy_decompress(&tls->cinfo);
+    free(tls->buf);
+    free(tls);
+    tls = NULL;
+}
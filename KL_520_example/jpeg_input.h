@@ -0,0 +1,42 @@
+/**
+ * @file        jpeg_input.h
+ * @brief       Decode JPEG inputs at the smallest DCT scale that still covers the model input
+ * @version     0.1
+ * @date        2026-10-19
+ *
+ * libjpeg can run the inverse DCT at 1/2, 1/4 or 1/8 of the coded size, which skips the IDCT,
+ * upsampling and color conversion work for pixels the 224x224 model input would throw away anyway.
+ * The image is decoded into a buffer owned by the calling thread and reused by its next call, so
+ * there is no per-frame allocation either.
+ */
+
+#ifndef __JPEG_INPUT_H__
+#define __JPEG_INPUT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+/* Decode path as 8-bit BGR (same channel order as cv::imread), scaled down by the largest of
+ * 1/8, 1/4, 1/2 that keeps width >= min_w and height >= min_h. Rows are width * 3 bytes apart.
+ * Returns NULL if the file is not a JPEG libjpeg can convert to BGR or it fails to decode; the
+ * caller then falls back to its generic loader. The pixels stay valid until the same thread calls
+ * jpeg_input_decode() or jpeg_input_release() again.
+ * scale (may be NULL) receives the scale used, in eighths: 8 is full size, 4 is 1/2. */
+const uint8_t *jpeg_input_decode(const char *path, int min_w, int min_h, int *width, int *height, int *scale);
+
+/* Same, from a JPEG file already in memory */
+const uint8_t *jpeg_input_decode_mem(const uint8_t *data, size_t len, int min_w, int min_h, int *width, int *height,
+                                     int *scale);
+
+/* Free the calling thread's decoder and buffer */
+void jpeg_input_release(void);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif
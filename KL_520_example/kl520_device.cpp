@@ -0,0 +1,530 @@
+/**
+ * @file        kl520_device.cpp
+ * @brief       DME device interface: KL520 over USB, or a simulated device for dongle-less boxes
+ * @version     0.1
+ * @date        2026-10-19
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "kl520_device.h"
+
+#define SIM_NODE_COL_ALIGN      16  /* KDP_COL_MIN */
+
+/* reset_mode of kdp_reset_sys() */
+#define USB_RESET_PROTOCOL      1
+#define USB_RESET_SYSTEM        255
+#define USB_SERIAL_MAX          16
+#define USB_REBOOT_WAIT_MS      10000
+#define USB_REBOOT_POLL_MS      100
+
+uint64_t kl520_mono_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void kl520_sleep_until_ns(uint64_t t_ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = t_ns / 1000000000ull;
+    ts.tv_nsec = t_ns % 1000000000ull;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+int kl520_dev_load_nef(struct kl520_dev_s *dev, const char *nef_path)
+{
+    uint32_t ret_size = 0;
+    char *model_buf;
+    long model_size;
+    FILE *fp;
+    int ret;
+
+    fp = fopen(nef_path, "rb");
+    if (fp == NULL) {
+        printf("[%s] could not open NEF '%s'\n", dev->name, nef_path);
+        return -1;
+    }
+    fseek(fp, 0, SEEK_END);
+    model_size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    model_buf = (char *)malloc(model_size);
+    if (model_buf == NULL || fread(model_buf, 1, model_size, fp) != (size_t)model_size) {
+        printf("[%s] could not read NEF '%s'\n", dev->name, nef_path);
+        free(model_buf);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    ret = dev->ops->start_dme(dev, model_buf, model_size, &ret_size);
+    free(model_buf);
+    if (ret != 0)
+        printf("[%s] could not set to DME mode:%d..\n", dev->name, ret_size);
+    return ret;
+}
+
+void kl520_dev_destroy(struct kl520_dev_s *dev)
+{
+    if (dev)
+        dev->ops->destroy(dev);
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * KL520 over USB
+ * ------------------------------------------------------------------------------------------- */
+
+/* serial number of every device we know by dev_idx, to find it again after a reboot; 0: unknown */
+static uint32_t usb_serial[USB_SERIAL_MAX];
+
+int kl520_usb_open(int count, int *dev_idx)
+{
+    kdp_device_info_list_t *list = NULL;
+    int i;
+
+    if (kdp_lib_init() < 0) {
+        printf("init for kdp host lib failed.\n");
+        return -1;
+    }
+
+    kdp_scan_usb_devices(&list);
+    if (list == NULL || list->num_dev < count) {
+        printf("found %d KL520 device(s), need %d\n", list ? list->num_dev : 0, count);
+        kdp_lib_de_init();
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        dev_idx[i] = kdp_connect_usb_device(list->kdevice[i].scan_index);
+        if (dev_idx[i] < 0) {
+            printf("could not connect device with scan index %d\n", list->kdevice[i].scan_index);
+            kdp_lib_de_init();
+            return -1;
+        }
+        if (dev_idx[i] < USB_SERIAL_MAX)
+            usb_serial[dev_idx[i]] = list->kdevice[i].serial_number;
+    }
+
+    if (kdp_lib_start() < 0) {
+        printf("starting for kdp host lib failed.\n");
+        kdp_lib_de_init();
+        return -1;
+    }
+    return 0;
+}
+
+void kl520_usb_close(void)
+{
+    kdp_lib_de_init();
+}
+
+/* kdp_dme_inference() wants somewhere to put the result in sync mode */
+struct usb_priv_s {
+    char inf_res[KL520_DEV_RES_SIZE];
+};
+
+static int usb_start_dme(struct kl520_dev_s *dev, char *model_buf, uint32_t model_size, uint32_t *ret_size)
+{
+    return kdp_start_dme_ext(dev->dev_idx, model_buf, model_size, ret_size);
+}
+
+static int usb_dme_configure(struct kl520_dev_s *dev, struct kdp_dme_cfg_s *dme_cfg, uint32_t *model_id)
+{
+    return kdp_dme_configure(dev->dev_idx, (char *)dme_cfg, sizeof(struct kdp_dme_cfg_s), model_id);
+}
+
+static int usb_dme_inference(struct kl520_dev_s *dev, char *img_buf, uint32_t buf_len, uint32_t *inf_size, uint32_t model_id)
+{
+    struct usb_priv_s *priv = (struct usb_priv_s *)dev->priv;
+    bool res_flag = true;
+
+    return kdp_dme_inference(dev->dev_idx, img_buf, buf_len, inf_size, &res_flag, priv->inf_res, 0, model_id);
+}
+
+static int usb_dme_retrieve_res(struct kl520_dev_s *dev, uint32_t inf_size, char *inf_res)
+{
+    return kdp_dme_retrieve_res(dev->dev_idx, 0, inf_size, inf_res);
+}
+
+static int usb_end_dme(struct kl520_dev_s *dev)
+{
+    return kdp_end_dme(dev->dev_idx);
+}
+
+static int usb_reset(struct kl520_dev_s *dev, int hard)
+{
+    kdp_device_info_list_t *list = NULL;
+    uint32_t serial;
+    int waited, i, idx;
+
+    if (!hard)
+        return kdp_reset_sys(dev->dev_idx, USB_RESET_PROTOCOL);
+
+    serial = dev->dev_idx >= 0 && dev->dev_idx < USB_SERIAL_MAX ? usb_serial[dev->dev_idx] : 0;
+    if (serial == 0) {
+        printf("[%s] serial number unknown, cannot find it again after a reboot\n", dev->name);
+        return KL520_DEV_RESET_UNSUPPORTED;
+    }
+    kdp_reset_sys(dev->dev_idx, USB_RESET_SYSTEM);
+
+    /* the reboot drops it off the bus: wait for it to show up again, then connect to it again */
+    for (waited = 0; waited < USB_REBOOT_WAIT_MS; waited += USB_REBOOT_POLL_MS) {
+        kl520_sleep_until_ns(kl520_mono_ns() + USB_REBOOT_POLL_MS * 1000000ull);
+        list = NULL;
+        if (kdp_scan_usb_devices(&list) != 0 || list == NULL)
+            continue;
+        for (i = 0; i < list->num_dev; i++) {
+            if (list->kdevice[i].serial_number != serial || !list->kdevice[i].isConnectable)
+                continue;
+            idx = kdp_connect_usb_device(list->kdevice[i].scan_index);
+            if (idx < 0)
+                break;
+            printf("[%s] back on the bus as usb%d\n", dev->name, idx);
+            if (idx < USB_SERIAL_MAX)
+                usb_serial[idx] = serial;
+            dev->dev_idx = idx;
+            snprintf(dev->name, sizeof(dev->name), "usb%d", idx);
+            return 0;
+        }
+    }
+    printf("[%s] did not come back after reset\n", dev->name);
+    return -1;
+}
+
+/* Serial number of the only connected device, 0 if there is none or more than one */
+static uint32_t usb_connected_serial(void)
+{
+    kdp_device_info_list_t *list = NULL;
+    uint32_t serial = 0;
+    int i, n = 0;
+
+    if (kdp_scan_usb_devices(&list) != 0 || list == NULL)
+        return 0;
+    for (i = 0; i < list->num_dev; i++) {
+        if (!list->kdevice[i].isConnectable) {
+            serial = list->kdevice[i].serial_number;
+            n++;
+        }
+    }
+    return n == 1 ? serial : 0;
+}
+
+static void usb_destroy(struct kl520_dev_s *dev)
+{
+    free(dev->priv);
+    free(dev);
+}
+
+static const struct kl520_dev_ops_s usb_ops = {
+    usb_start_dme,
+    usb_dme_configure,
+    usb_dme_inference,
+    usb_dme_retrieve_res,
+    usb_end_dme,
+    usb_reset,
+    usb_destroy,
+};
+
+struct kl520_dev_s *kl520_usb_device_create(int dev_idx)
+{
+    struct kl520_dev_s *dev = (struct kl520_dev_s *)calloc(1, sizeof(struct kl520_dev_s));
+
+    if (dev == NULL)
+        return NULL;
+
+    dev->priv = calloc(1, sizeof(struct usb_priv_s));
+    if (dev->priv == NULL) {
+        free(dev);
+        return NULL;
+    }
+
+    /* connected by someone else (main.cpp): with a single dongle connected, that one is it */
+    if (dev_idx >= 0 && dev_idx < USB_SERIAL_MAX && usb_serial[dev_idx] == 0)
+        usb_serial[dev_idx] = usb_connected_serial();
+
+    dev->ops = &usb_ops;
+    dev->dev_idx = dev_idx;
+    snprintf(dev->name, sizeof(dev->name), "usb%d", dev_idx);
+    return dev;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Simulated device
+ * ------------------------------------------------------------------------------------------- */
+
+/* Same layout as struct output_node_params */
+struct sim_node_params_s {
+    int height;
+    int channel;
+    int width;
+    int radix;
+    float scale;
+};
+
+struct sim_priv_s {
+    struct kl520_sim_cfg_s cfg;
+    pthread_mutex_t lock;           /* one frame on the NPU at a time, like the dongle */
+    int nef_loaded;
+    int configured;
+    int faulted;                    /* needs a reset */
+    int disconnected;               /* needs a hard reset */
+    struct kdp_dme_cfg_s dme_cfg;
+    uint32_t rand_state;
+    uint32_t res_len;
+    char res[KL520_DEV_RES_SIZE];
+};
+
+void kl520_sim_cfg_default(struct kl520_sim_cfg_s *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->frame_latency_us = 10000;
+    cfg->jitter_us = 0;
+    cfg->load_us_per_mb = 200000;
+    cfg->configure_us = 2000;
+    cfg->output_ch = 15;
+    cfg->fault_ppm = 0;
+    cfg->fault_mask = KL520_SIM_FAULT_ALL;
+    cfg->hang_ms = 2000;
+    cfg->reset_us = 20000;
+    cfg->reboot_us = 1500000;
+}
+
+uint32_t kl520_sim_frame_signature(const char *img_buf, uint32_t buf_len)
+{
+    uint32_t h = 2166136261u;   /* FNV-1a over 32-bit words */
+    uint32_t i, w;
+
+    for (i = 0; i + 4 <= buf_len; i += 4) {
+        memcpy(&w, img_buf + i, 4);
+        h = (h ^ w) * 16777619u;
+    }
+    for (; i < buf_len; i++)
+        h = (h ^ (uint8_t)img_buf[i]) * 16777619u;
+    return h;
+}
+
+static uint32_t sim_rand(struct sim_priv_s *priv)
+{
+    /* xorshift32 */
+    uint32_t x = priv->rand_state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    priv->rand_state = x;
+    return x;
+}
+
+/* called with priv->lock held, at the start of a frame */
+static void sim_inject_fault(struct sim_priv_s *priv)
+{
+    uint32_t kinds[4], n = 0, kind, i;
+
+    for (i = 0; i < 4; i++) {
+        if (priv->cfg.fault_mask & (1u << i))
+            kinds[n++] = 1u << i;
+    }
+    if (n == 0)
+        return;
+    kind = kinds[sim_rand(priv) % n];
+
+    priv->faulted = 1;
+    if (kind == KL520_SIM_FAULT_HANG)
+        kl520_sleep_until_ns(kl520_mono_ns() + (uint64_t)priv->cfg.hang_ms * 1000000);
+    else if (kind == KL520_SIM_FAULT_LOST_MODEL)
+        priv->nef_loaded = 0;
+    else if (kind == KL520_SIM_FAULT_DISCONNECT)
+        priv->disconnected = 1;
+}
+
+static int sim_start_dme(struct kl520_dev_s *dev, char *model_buf, uint32_t model_size, uint32_t *ret_size)
+{
+    struct sim_priv_s *priv = (struct sim_priv_s *)dev->priv;
+    uint64_t t_end;
+
+    pthread_mutex_lock(&priv->lock);
+    if (priv->faulted) {
+        pthread_mutex_unlock(&priv->lock);
+        return -1;
+    }
+    t_end = kl520_mono_ns() + (uint64_t)model_size * priv->cfg.load_us_per_mb / (1024 * 1024) * 1000;
+    kl520_sleep_until_ns(t_end);
+    priv->nef_loaded = 1;
+    priv->configured = 0;
+    *ret_size = model_size;
+    pthread_mutex_unlock(&priv->lock);
+    return 0;
+}
+
+static int sim_dme_configure(struct kl520_dev_s *dev, struct kdp_dme_cfg_s *dme_cfg, uint32_t *model_id)
+{
+    struct sim_priv_s *priv = (struct sim_priv_s *)dev->priv;
+    int ret = -1;
+
+    pthread_mutex_lock(&priv->lock);
+    if (priv->nef_loaded && !priv->faulted) {
+        kl520_sleep_until_ns(kl520_mono_ns() + (uint64_t)priv->cfg.configure_us * 1000);
+        priv->dme_cfg = *dme_cfg;
+        priv->configured = 1;
+        *model_id = dme_cfg->model_id;
+        ret = 0;
+    }
+    pthread_mutex_unlock(&priv->lock);
+    return ret;
+}
+
+static int sim_dme_inference(struct kl520_dev_s *dev, char *img_buf, uint32_t buf_len, uint32_t *inf_size, uint32_t model_id)
+{
+    struct sim_priv_s *priv = (struct sim_priv_s *)dev->priv;
+    struct sim_node_params_s node;
+    uint64_t t_end, latency_ns;
+    uint32_t sig;
+    int output_num = 1;
+    int c;
+
+    pthread_mutex_lock(&priv->lock);
+    latency_ns = (uint64_t)priv->cfg.frame_latency_us * 1000;
+    if (priv->cfg.jitter_us) {
+        int64_t j = (int64_t)(sim_rand(priv) % (2 * priv->cfg.jitter_us + 1)) - priv->cfg.jitter_us;
+        latency_ns = (int64_t)latency_ns + j * 1000 > 0 ? (int64_t)latency_ns + j * 1000 : 0;
+    }
+    t_end = kl520_mono_ns() + latency_ns;
+
+    if (!priv->faulted && priv->cfg.fault_ppm && sim_rand(priv) % 1000000 < priv->cfg.fault_ppm)
+        sim_inject_fault(priv);
+    if (priv->faulted) {
+        pthread_mutex_unlock(&priv->lock);
+        return -1;
+    }
+
+    if (!priv->nef_loaded || !priv->configured || (uint32_t)priv->dme_cfg.model_id != model_id ||
+        ((priv->dme_cfg.image_format & NPU_FORMAT_RGB565) &&
+         buf_len != (uint32_t)(priv->dme_cfg.image_col * priv->dme_cfg.image_row * 2))) {
+        pthread_mutex_unlock(&priv->lock);
+        return -1;
+    }
+
+    sig = kl520_sim_frame_signature(img_buf, buf_len);
+
+    node.height = 1;
+    node.channel = priv->cfg.output_ch;
+    node.width = 1;
+    node.radix = 0;
+    node.scale = 1.0f;
+    memcpy(priv->res, &output_num, sizeof(int));
+    memcpy(priv->res + sizeof(int), &node, sizeof(node));
+    priv->res_len = sizeof(int) + sizeof(node);
+    for (c = 0; c < node.channel; c++) {
+        memset(priv->res + priv->res_len, 0, SIM_NODE_COL_ALIGN);
+        priv->res[priv->res_len] = (int8_t)((sig >> (c % 24)) & 0x7f);
+        priv->res_len += SIM_NODE_COL_ALIGN;
+    }
+
+    kl520_sleep_until_ns(t_end);
+    *inf_size = priv->res_len;
+    pthread_mutex_unlock(&priv->lock);
+    return 0;
+}
+
+static int sim_dme_retrieve_res(struct kl520_dev_s *dev, uint32_t inf_size, char *inf_res)
+{
+    struct sim_priv_s *priv = (struct sim_priv_s *)dev->priv;
+    int ret = -1;
+
+    pthread_mutex_lock(&priv->lock);
+    if (!priv->faulted && inf_size <= priv->res_len) {
+        memcpy(inf_res, priv->res, inf_size);
+        ret = 0;
+    }
+    pthread_mutex_unlock(&priv->lock);
+    return ret;
+}
+
+static int sim_end_dme(struct kl520_dev_s *dev)
+{
+    struct sim_priv_s *priv = (struct sim_priv_s *)dev->priv;
+
+    pthread_mutex_lock(&priv->lock);
+    priv->configured = 0;
+    pthread_mutex_unlock(&priv->lock);
+    return 0;
+}
+
+static int sim_reset(struct kl520_dev_s *dev, int hard)
+{
+    struct sim_priv_s *priv = (struct sim_priv_s *)dev->priv;
+    int ret = 0;
+
+    pthread_mutex_lock(&priv->lock);
+    if (hard) {
+        kl520_sleep_until_ns(kl520_mono_ns() + (uint64_t)priv->cfg.reboot_us * 1000);
+        priv->nef_loaded = 0;
+        priv->disconnected = 0;
+    } else if (priv->disconnected) {
+        ret = -1;
+    } else {
+        kl520_sleep_until_ns(kl520_mono_ns() + (uint64_t)priv->cfg.reset_us * 1000);
+    }
+    if (ret == 0) {
+        priv->faulted = 0;
+        priv->configured = 0;
+    }
+    pthread_mutex_unlock(&priv->lock);
+    return ret;
+}
+
+static void sim_destroy(struct kl520_dev_s *dev)
+{
+    struct sim_priv_s *priv = (struct sim_priv_s *)dev->priv;
+
+    pthread_mutex_destroy(&priv->lock);
+    free(priv);
+    free(dev);
+}
+
+static const struct kl520_dev_ops_s sim_ops = {
+    sim_start_dme,
+    sim_dme_configure,
+    sim_dme_inference,
+    sim_dme_retrieve_res,
+    sim_end_dme,
+    sim_reset,
+    sim_destroy,
+};
+
+struct kl520_dev_s *kl520_sim_device_create(int dev_idx, const struct kl520_sim_cfg_s *cfg)
+{
+    struct kl520_dev_s *dev = (struct kl520_dev_s *)calloc(1, sizeof(struct kl520_dev_s));
+    struct sim_priv_s *priv;
+
+    if (dev == NULL)
+        return NULL;
+
+    priv = (struct sim_priv_s *)calloc(1, sizeof(struct sim_priv_s));
+    if (priv == NULL) {
+        free(dev);
+        return NULL;
+    }
+
+    priv->cfg = *cfg;
+    if (priv->cfg.output_ch <= 0)
+        priv->cfg.output_ch = 15;
+    priv->rand_state = 0x9e3779b9u ^ (uint32_t)dev_idx;
+    pthread_mutex_init(&priv->lock, NULL);
+
+    dev->ops = &sim_ops;
+    dev->dev_idx = dev_idx;
+    dev->priv = priv;
+    snprintf(dev->name, sizeof(dev->name), "sim%d", dev_idx);
+    return dev;
+}
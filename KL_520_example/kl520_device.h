@@ -0,0 +1,100 @@
+/**
+ * @file        kl520_device.h
+ * @brief       DME device interface: KL520 over USB, or a simulated device for dongle-less boxes
+ * @version     0.1
+ * @date        2026-10-19
+ */
+
+#ifndef __KL520_DEVICE_H__
+#define __KL520_DEVICE_H__
+
+#include <stdint.h>
+#include "kdp_host.h"
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+#define KL520_DEV_NAME_LEN      32
+#define KL520_DEV_RES_SIZE      (256 * 1024)    /* enough for any kdp_dme_retrieve_res() of our models */
+#define KL520_DEV_RESET_UNSUPPORTED (-2)        /* reset(): this device cannot do that kind of reset */
+
+struct kl520_dev_s;
+
+/* The DME calls made by user_test_dme(), one device at a time. Every op returns 0 on success.
+ * No call can be cancelled: a hung USB call returns only when host_lib's own USB timeout fires. */
+struct kl520_dev_ops_s {
+    int (*start_dme)(struct kl520_dev_s *dev, char *model_buf, uint32_t model_size, uint32_t *ret_size);
+    int (*dme_configure)(struct kl520_dev_s *dev, struct kdp_dme_cfg_s *dme_cfg, uint32_t *model_id);
+    int (*dme_inference)(struct kl520_dev_s *dev, char *img_buf, uint32_t buf_len, uint32_t *inf_size, uint32_t model_id);
+    int (*dme_retrieve_res)(struct kl520_dev_s *dev, uint32_t inf_size, char *inf_res);
+    int (*end_dme)(struct kl520_dev_s *dev);
+    /* Recover from a failed or hung call. Soft: reset the message protocol, the NEF may survive.
+     * Hard: reboot the device and reconnect; NEF and DME configuration are gone afterwards.
+     * Over USB the device is found again by serial number and gets a new dev_idx and name;
+     * KL520_DEV_RESET_UNSUPPORTED if its serial number is not known. */
+    int (*reset)(struct kl520_dev_s *dev, int hard);
+    void (*destroy)(struct kl520_dev_s *dev);
+};
+
+struct kl520_dev_s {
+    const struct kl520_dev_ops_s *ops;
+    int dev_idx;
+    char name[KL520_DEV_NAME_LEN];
+    void *priv;
+};
+
+struct kl520_sim_cfg_s {
+    uint32_t frame_latency_us;      /* NPU + USB time per frame, what the dongle would take */
+    uint32_t jitter_us;             /* uniform +/- jitter added to frame_latency_us */
+    uint32_t load_us_per_mb;        /* NEF upload time in kdp_start_dme_ext() */
+    uint32_t configure_us;          /* kdp_dme_configure() time, paid again on every model switch */
+    int output_ch;                  /* channels of the single 1x1 output node, 15 for model01 */
+
+    /* fault injection, one draw per dme_inference() */
+    uint32_t fault_ppm;             /* chance of a fault per frame, in 1e-6; 0: never */
+    uint32_t fault_mask;            /* which enum kl520_sim_fault_e kinds to draw from */
+    uint32_t hang_ms;               /* how long a KL520_SIM_FAULT_HANG call blocks before failing */
+    uint32_t reset_us;              /* soft reset time */
+    uint32_t reboot_us;             /* hard reset time, until the device is back on the bus */
+};
+
+enum kl520_sim_fault_e {
+    KL520_SIM_FAULT_ERROR       = 1 << 0,   /* the call fails, a soft reset clears it */
+    KL520_SIM_FAULT_HANG        = 1 << 1,   /* the call blocks for hang_ms, then fails */
+    KL520_SIM_FAULT_LOST_MODEL  = 1 << 2,   /* firmware restarted: fails, and the NEF is gone */
+    KL520_SIM_FAULT_DISCONNECT  = 1 << 3,   /* off the bus: everything fails until a hard reset */
+    KL520_SIM_FAULT_ALL         = 0xf,
+};
+
+/* kdp_lib_init() + connect the first count USB devices + kdp_lib_start().
+ * Fills dev_idx[] and returns 0, or -1 if fewer than count devices are found. */
+int kl520_usb_open(int count, int *dev_idx);
+void kl520_usb_close(void);
+
+struct kl520_dev_s *kl520_usb_device_create(int dev_idx);
+
+void kl520_sim_cfg_default(struct kl520_sim_cfg_s *cfg);
+struct kl520_dev_s *kl520_sim_device_create(int dev_idx, const struct kl520_sim_cfg_s *cfg);
+
+/* The simulated device answers every frame with output_ch int8 values (radix 0, scale 1)
+ * derived from this signature, so callers can check that results went to the right frame:
+ * channel c = (int8_t)((sig >> (c % 24)) & 0x7f) */
+uint32_t kl520_sim_frame_signature(const char *img_buf, uint32_t buf_len);
+
+/* Read the NEF file and run start_dme with it */
+int kl520_dev_load_nef(struct kl520_dev_s *dev, const char *nef_path);
+
+void kl520_dev_destroy(struct kl520_dev_s *dev);
+
+/* CLOCK_MONOTONIC in ns */
+uint64_t kl520_mono_ns(void);
+
+/* Sleep until kl520_mono_ns() reaches t_ns */
+void kl520_sleep_until_ns(uint64_t t_ns);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,854 @@
+/**
+ * @file        kl520_dme_bench.cpp
+ * @brief       Open-loop load generator and SLO benchmark for the user_test_dme() flow
+ * @version     0.1
+ * @date        2026-10-19
+ *
+ * Every request gets an intended arrival time from a Poisson (or constant rate) schedule fixed
+ * before the run starts, and its latency is measured from that time, not from when a worker got
+ * around to it. A device that stalls therefore shows up as queueing delay in every request that
+ * arrived behind it, instead of silently lowering the offered load (coordinated omission).
+ *
+ * Per request: preprocess (resize + RGB565, optionally decode) -> dme_inference ->
+ * dme_retrieve_res -> dequant (every output node to float, what post_processing_simplest does for
+ * user_test_dme, minus its printing; no model specific post-processing). JPEGs are decoded with jpeg_input
+ * at reduced DCT scale, like user_test_dme(), when built with libjpeg. The NEF upload and
+ * dme_configure happen once per device before the first run.
+ *
+ * e.g. sweep a simulated 8 ms device up to saturation and keep the numbers:
+ *
+ *   ./kl520_dme_bench -S 1 -l 8000 -i ../../images -t 10 -s 50 -o bench.json
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <vector>
+#include <string>
+
+#include "kl520_device.h"
+#include "raw_output.h"
+#if defined(HAVE_JPEG_INPUT)
+#include "jpeg_input.h"
+#endif
+
+#include "opencv2/imgproc/imgproc.hpp"
+#include <opencv2/highgui/highgui.hpp>
+
+#define DME_MODEL_FILE      (HOST_LIB_DIR "/input_models/KL520/test_model/models_520.nef")
+
+#define MODEL_IMG_W         224
+#define MODEL_IMG_H         224
+#define INFERENCE_IMG_SIZE  (MODEL_IMG_W * MODEL_IMG_H * 2)
+
+#define BENCH_DEV_MAX       8
+#define BENCH_RATE_MAX      64
+#define BENCH_PROBE_FRAMES  20
+#define BENCH_KNEE_RATIO    0.95    /* completions / arrivals below this: saturated */
+#if defined(HAVE_JPEG_INPUT)
+#define BENCH_JPEG_SCALED   1
+#else
+#define BENCH_JPEG_SCALED   0
+#endif
+
+enum bench_stage_e {
+    STAGE_PRE = 0,
+    STAGE_INFER,
+    STAGE_RETRIEVE,
+    STAGE_DEQUANT,
+    STAGE_NUM,
+};
+
+static const char *stage_name[STAGE_NUM] = { "preprocess", "inference", "retrieve", "dequant" };
+
+enum bench_req_status_e {
+    REQ_PENDING = 0,
+    REQ_OK,
+    REQ_ERROR,
+    REQ_UNFINISHED,         /* drain budget ran out before it started */
+};
+
+struct bench_cfg_s {
+    const char *nef_path;
+    const char *image_dir;
+    const char *json_path;
+    int usb_count;
+    int sim_count;
+    struct kl520_sim_cfg_s sim;
+    uint32_t model_id;
+    int poisson;
+    int decode;             /* decode the image in the preprocess stage, not at load */
+    double rates[BENCH_RATE_MAX];
+    int rate_count;
+    double duration_s;
+    double warmup_s;
+    double drain_s;
+    double slo_ms;          /* p99 objective, 0: none */
+    uint64_t seed;
+};
+
+struct bench_image_s {
+    std::vector<uchar> bytes;
+    cv::Mat bgr;
+};
+
+struct bench_req_s {
+    uint64_t t_arrival;
+    uint64_t t_start;
+    uint64_t t_done;
+    uint32_t image;
+    int status;
+};
+
+struct bench_run_s {
+    double rate;
+    int count;
+    struct bench_req_s *req;
+    int next;               /* next request to take, shared by the workers */
+    uint64_t t0;
+    uint64_t t_drain_end;   /* requests not started by then are REQ_UNFINISHED */
+};
+
+struct bench_worker_s {
+    pthread_t thread;
+    struct kl520_dev_s *dev;
+    uint32_t model_id;
+    const struct bench_cfg_s *cfg;
+    const std::vector<bench_image_s> *images;
+    struct bench_run_s *run;
+    char *res;
+    float *res_float;
+    cv::Mat decoded, resized, rgb565;
+    uint64_t stage_cpu_ns[STAGE_NUM];
+    uint64_t stage_wall_ns[STAGE_NUM];
+    int frames;
+};
+
+struct bench_result_s {
+    double offered_rps;
+    double arrived_rps;     /* what the schedule actually produced inside the measured window */
+    double achieved_rps;
+    int requests;           /* arrived inside the measured window */
+    int ok;
+    int errors;
+    int unfinished;
+    double lat_ms[4];       /* p50, p99, p99.9, max, unfinished requests count at their lower bound */
+    double queue_ms[4];
+    double service_ms[4];
+    double stage_cpu_ms[STAGE_NUM];     /* per frame */
+    double stage_wall_ms[STAGE_NUM];    /* per frame */
+    double stage_util[STAGE_NUM];       /* cpu time / run time, 1.0 = one core */
+    double process_util;
+    int saturated;
+    const char *reason;
+};
+
+static const double pct_points[4] = { 0.50, 0.99, 0.999, 1.0 };
+
+static uint64_t thread_cpu_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint64_t process_cpu_ns(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ull +
+           (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ull;
+}
+
+static double rand_uniform(uint64_t *state)
+{
+    /* xorshift64*, (0, 1] */
+    uint64_t x = *state;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return ((x * 2685821657736338717ull) >> 11) * (1.0 / 9007199254740992.0) + 1.0 / 9007199254740992.0;
+}
+
+static int cmp_u64(const void *pa, const void *pb)
+{
+    uint64_t a = *(const uint64_t *)pa, b = *(const uint64_t *)pb;
+    return a < b ? -1 : a > b;
+}
+
+/* nearest rank, so p99.9 of 1000 samples is the largest but one */
+static void percentiles_ms(uint64_t *v, int n, double *out)
+{
+    int i, rank;
+
+    qsort(v, n, sizeof(uint64_t), cmp_u64);
+    for (i = 0; i < 4; i++) {
+        if (n == 0) {
+            out[i] = 0;
+            continue;
+        }
+        rank = (int)ceil(pct_points[i] * n);
+        out[i] = v[(rank < 1 ? 1 : rank) - 1] / 1e6;
+    }
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * One request through the user_test_dme() flow
+ * ------------------------------------------------------------------------------------------- */
+
+// JPEGs are decoded at the reduced DCT scale user_test_dme() uses, everything else by cv::imdecode.
+// A JPEG result points into this thread's jpeg_input buffer and is only valid until its next decode.
+static cv::Mat decode_image(const std::vector<uchar> &bytes)
+{
+#if defined(HAVE_JPEG_INPUT)
+    int width, height;
+    const uint8_t *bgr = jpeg_input_decode_mem(bytes.data(), bytes.size(), MODEL_IMG_W, MODEL_IMG_H,
+                                               &width, &height, NULL);
+
+    if (bgr != NULL)
+        return cv::Mat(height, width, CV_8UC3, (void *)bgr);
+#endif
+    return cv::imdecode(bytes, cv::IMREAD_COLOR);
+}
+
+static int preprocess(struct bench_worker_s *w, const struct bench_image_s *image)
+{
+    const cv::Mat *img = &image->bgr;
+
+    if (w->cfg->decode) {
+        w->decoded = decode_image(image->bytes);
+        if (w->decoded.empty())
+            return -1;
+        img = &w->decoded;
+    }
+
+    if (img->cols != MODEL_IMG_W || img->rows != MODEL_IMG_H) {
+        cv::resize(*img, w->resized, cv::Size(MODEL_IMG_W, MODEL_IMG_H), 0, 0, cv::INTER_AREA);
+        img = &w->resized;
+    }
+    cv::cvtColor(*img, w->rgb565, CV_BGR2BGR565);
+    return 0;
+}
+
+static int dequant(struct bench_worker_s *w, uint32_t inf_size)
+{
+    struct raw_output_node_s nodes[RAW_OUTPUT_NODE_MAX];
+    int i, n, offset = 0;
+
+    n = raw_output_parse(w->res, inf_size, nodes, RAW_OUTPUT_NODE_MAX);
+    if (n <= 0)
+        return -1;
+    /* every node gets its own part of res_float, one after the other */
+    for (i = 0; i < n; i++) {
+        if (raw_output_node_len(&nodes[i]) > KL520_DEV_RES_SIZE - offset)
+            return -1;
+        raw_output_dequant(&nodes[i], w->res_float + offset);
+        offset += raw_output_node_len(&nodes[i]);
+    }
+    return 0;
+}
+
+static int run_request(struct bench_worker_s *w, const struct bench_image_s *image)
+{
+    uint64_t cpu[STAGE_NUM + 1], wall[STAGE_NUM + 1];
+    uint32_t inf_size = 0;
+    int i, ret;
+
+    cpu[0] = thread_cpu_ns();
+    wall[0] = kl520_mono_ns();
+    ret = preprocess(w, image);
+
+    cpu[1] = thread_cpu_ns();
+    wall[1] = kl520_mono_ns();
+    if (ret == 0)
+        ret = w->dev->ops->dme_inference(w->dev, (char *)w->rgb565.data, INFERENCE_IMG_SIZE, &inf_size, w->model_id);
+
+    cpu[2] = thread_cpu_ns();
+    wall[2] = kl520_mono_ns();
+    if (ret == 0)
+        ret = w->dev->ops->dme_retrieve_res(w->dev, inf_size, w->res);
+
+    cpu[3] = thread_cpu_ns();
+    wall[3] = kl520_mono_ns();
+    if (ret == 0)
+        ret = dequant(w, inf_size);
+
+    cpu[4] = thread_cpu_ns();
+    wall[4] = kl520_mono_ns();
+
+    for (i = 0; i < STAGE_NUM; i++) {
+        w->stage_cpu_ns[i] += cpu[i + 1] - cpu[i];
+        w->stage_wall_ns[i] += wall[i + 1] - wall[i];
+    }
+    w->frames++;
+    return ret;
+}
+
+static void *worker_thread(void *arg)
+{
+    struct bench_worker_s *w = (struct bench_worker_s *)arg;
+    struct bench_run_s *run = w->run;
+    struct bench_req_s *r;
+    int i;
+
+    for (;;) {
+        i = __atomic_fetch_add(&run->next, 1, __ATOMIC_RELAXED);
+        if (i >= run->count)
+            break;
+        r = &run->req[i];
+
+        /* open loop: never earlier than scheduled, and late starts count as queueing */
+        kl520_sleep_until_ns(r->t_arrival);
+        r->t_start = kl520_mono_ns();
+        if (r->t_start > run->t_drain_end) {
+            r->status = REQ_UNFINISHED;
+            continue;
+        }
+        r->status = run_request(w, &(*w->images)[r->image]) == 0 ? REQ_OK : REQ_ERROR;
+        r->t_done = kl520_mono_ns();
+    }
+#if defined(HAVE_JPEG_INPUT)
+    jpeg_input_release();
+#endif
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Runs
+ * ------------------------------------------------------------------------------------------- */
+
+static int make_schedule(struct bench_run_s *run, const struct bench_cfg_s *cfg, int image_count, uint64_t *seed)
+{
+    double t = 0, end = cfg->warmup_s + cfg->duration_s;
+    int cap = (int)(run->rate * end * 1.5) + 64, n = 0;
+
+    run->req = (struct bench_req_s *)calloc(cap, sizeof(struct bench_req_s));
+    if (run->req == NULL)
+        return -1;
+
+    for (;;) {
+        t += cfg->poisson ? -log(rand_uniform(seed)) / run->rate : 1.0 / run->rate;
+        if (t >= end)
+            break;
+        if (n == cap) {
+            struct bench_req_s *req = (struct bench_req_s *)realloc(run->req, 2 * cap * sizeof(struct bench_req_s));
+            if (req == NULL)
+                return -1;
+            memset(req + cap, 0, cap * sizeof(struct bench_req_s));
+            run->req = req;
+            cap *= 2;
+        }
+        run->req[n].t_arrival = (uint64_t)(t * 1e9);
+        run->req[n].image = (uint32_t)(rand_uniform(seed) * image_count) % image_count;
+        n++;
+    }
+    run->count = n;
+    return 0;
+}
+
+static int summarize(const struct bench_run_s *run, struct bench_worker_s *workers, int worker_count,
+                      const struct bench_cfg_s *cfg, uint64_t run_ns, uint64_t process_ns,
+                      struct bench_result_s *res)
+{
+    uint64_t warm_end = run->t0 + (uint64_t)(cfg->warmup_s * 1e9);
+    uint64_t window_end = warm_end + (uint64_t)(cfg->duration_s * 1e9);
+    uint64_t *lat, *queue, *service, cpu, wall;
+    int i, s, n = 0, nq = 0, arrived_in_window = 0, done_in_window = 0, frames = 0;
+
+    memset(res, 0, sizeof(*res));
+    res->offered_rps = run->rate;
+
+    lat = (uint64_t *)malloc((run->count + 1) * sizeof(uint64_t));
+    queue = (uint64_t *)malloc((run->count + 1) * sizeof(uint64_t));
+    service = (uint64_t *)malloc((run->count + 1) * sizeof(uint64_t));
+    if (lat == NULL || queue == NULL || service == NULL) {
+        free(lat);
+        free(queue);
+        free(service);
+        return -1;
+    }
+
+    for (i = 0; i < run->count; i++) {
+        const struct bench_req_s *r = &run->req[i];
+
+        if (r->status == REQ_OK && r->t_done >= warm_end && r->t_done < window_end)
+            done_in_window++;
+        if (r->t_arrival < warm_end)
+            continue;
+        if (r->t_arrival < window_end)
+            arrived_in_window++;
+
+        res->requests++;
+        if (r->status == REQ_OK) {
+            res->ok++;
+            lat[n++] = r->t_done - r->t_arrival;
+            queue[nq] = r->t_start - r->t_arrival;
+            service[nq++] = r->t_done - r->t_start;
+        } else if (r->status == REQ_UNFINISHED) {
+            /* still waiting when the run was cut: what it had waited so far is a lower bound */
+            res->unfinished++;
+            lat[n++] = run->t_drain_end - r->t_arrival;
+        } else {
+            res->errors++;
+        }
+    }
+
+    percentiles_ms(lat, n, res->lat_ms);
+    percentiles_ms(queue, nq, res->queue_ms);
+    percentiles_ms(service, nq, res->service_ms);
+    res->arrived_rps = arrived_in_window / cfg->duration_s;
+    res->achieved_rps = done_in_window / cfg->duration_s;
+
+    for (i = 0; i < worker_count; i++)
+        frames += workers[i].frames;
+    for (s = 0; s < STAGE_NUM; s++) {
+        cpu = wall = 0;
+        for (i = 0; i < worker_count; i++) {
+            cpu += workers[i].stage_cpu_ns[s];
+            wall += workers[i].stage_wall_ns[s];
+        }
+        res->stage_cpu_ms[s] = frames ? cpu / 1e6 / frames : 0;
+        res->stage_wall_ms[s] = frames ? wall / 1e6 / frames : 0;
+        res->stage_util[s] = (double)cpu / run_ns;
+    }
+    res->process_util = (double)process_ns / run_ns;
+
+    if (res->errors) {
+        res->saturated = 1;
+        res->reason = "errors";
+    } else if (res->unfinished) {
+        res->saturated = 1;
+        res->reason = "backlog not drained";
+    } else if (res->achieved_rps < BENCH_KNEE_RATIO * res->arrived_rps) {
+        /* against arrivals, not the nominal rate, so Poisson noise alone does not look like saturation */
+        res->saturated = 1;
+        res->reason = "throughput below arrival rate";
+    } else if (cfg->slo_ms > 0 && res->lat_ms[1] > cfg->slo_ms) {
+        res->saturated = 1;
+        res->reason = "p99 above SLO";
+    }
+
+    free(lat);
+    free(queue);
+    free(service);
+    return 0;
+}
+
+static int bench_run(double rate, const struct bench_cfg_s *cfg, struct bench_worker_s *workers, int worker_count,
+                     const std::vector<bench_image_s> &images, uint64_t *seed, struct bench_result_s *res)
+{
+    struct bench_run_s run;
+    uint64_t t_begin, cpu_begin;
+    int i, s, ret;
+
+    memset(&run, 0, sizeof(run));
+    run.rate = rate;
+    if (make_schedule(&run, cfg, (int)images.size(), seed) != 0) {
+        printf("out of memory for %.1f rps\n", rate);
+        return -1;
+    }
+
+    /* schedule is relative until now, give the workers a moment to start */
+    run.t0 = kl520_mono_ns() + 20000000ull;
+    for (i = 0; i < run.count; i++)
+        run.req[i].t_arrival += run.t0;
+    run.t_drain_end = run.t0 + (uint64_t)((cfg->warmup_s + cfg->duration_s + cfg->drain_s) * 1e9);
+
+    for (i = 0; i < worker_count; i++) {
+        workers[i].run = &run;
+        workers[i].frames = 0;
+        for (s = 0; s < STAGE_NUM; s++)
+            workers[i].stage_cpu_ns[s] = workers[i].stage_wall_ns[s] = 0;
+    }
+
+    t_begin = kl520_mono_ns();
+    cpu_begin = process_cpu_ns();
+    for (i = 0; i < worker_count; i++)
+        pthread_create(&workers[i].thread, NULL, worker_thread, &workers[i]);
+    for (i = 0; i < worker_count; i++)
+        pthread_join(workers[i].thread, NULL);
+
+    ret = summarize(&run, workers, worker_count, cfg, kl520_mono_ns() - t_begin, process_cpu_ns() - cpu_begin, res);
+    free(run.req);
+    if (ret != 0)
+        printf("out of memory summarizing %.1f rps\n", rate);
+    return ret;
+}
+
+/* Serve a few frames back to back to estimate what the devices can sustain */
+static double probe_capacity(struct bench_worker_s *workers, int worker_count, const std::vector<bench_image_s> &images)
+{
+    uint64_t t0;
+    int i;
+
+    for (i = 0; i < 2; i++)
+        run_request(&workers[0], &images[i % images.size()]);
+
+    t0 = kl520_mono_ns();
+    for (i = 0; i < BENCH_PROBE_FRAMES; i++) {
+        if (run_request(&workers[0], &images[i % images.size()]) != 0)
+            return 0;
+    }
+    return worker_count * BENCH_PROBE_FRAMES / ((kl520_mono_ns() - t0) / 1e9);
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Report
+ * ------------------------------------------------------------------------------------------- */
+
+static void print_result(const struct bench_result_s *r)
+{
+    int s;
+
+    printf("%8.1f rps offered, %8.1f arrived, %8.1f achieved | latency ms p50 %7.2f p99 %7.2f p99.9 %7.2f max %7.2f | "
+           "queue p99 %7.2f service p99 %6.2f | %d unfinished %d errors%s%s\n",
+           r->offered_rps, r->arrived_rps, r->achieved_rps, r->lat_ms[0], r->lat_ms[1], r->lat_ms[2], r->lat_ms[3],
+           r->queue_ms[1], r->service_ms[1], r->unfinished, r->errors,
+           r->saturated ? "  <- " : "", r->saturated ? r->reason : "");
+    printf("         cpu ms/frame:");
+    for (s = 0; s < STAGE_NUM; s++)
+        printf(" %s %.3f (%.0f%%)", stage_name[s], r->stage_cpu_ms[s], 100 * r->stage_util[s]);
+    printf(", process %.0f%%\n", 100 * r->process_util);
+}
+
+static void json_pcts(FILE *fp, const char *name, const double *v)
+{
+    fprintf(fp, "\"%s\": {\"p50\": %.4f, \"p99\": %.4f, \"p999\": %.4f, \"max\": %.4f}", name, v[0], v[1], v[2], v[3]);
+}
+
+static int write_json(const char *path, const struct bench_cfg_s *cfg, int image_count, const char *device,
+                      const struct bench_result_s *res, int res_count, int knee)
+{
+    FILE *fp = fopen(path, "w");
+    int i, s;
+
+    if (fp == NULL) {
+        printf("could not write '%s'\n", path);
+        return -1;
+    }
+
+    fprintf(fp, "{\n  \"tool\": \"kl520_dme_bench\",\n  \"format\": 1,\n");
+    fprintf(fp, "  \"config\": {\"device\": \"%s\", \"devices\": %d, \"sim_frame_latency_us\": %u, "
+                "\"sim_jitter_us\": %u, \"model_id\": %u, \"arrivals\": \"%s\", \"decode_per_frame\": %s, \"jpeg_scaled\": %s, "
+                "\"images\": %d, \"duration_s\": %.3f, \"warmup_s\": %.3f, \"drain_s\": %.3f, "
+                "\"slo_p99_ms\": %.3f, \"seed\": %llu},\n",
+            device, cfg->usb_count ? cfg->usb_count : cfg->sim_count, cfg->usb_count ? 0 : cfg->sim.frame_latency_us,
+            cfg->usb_count ? 0 : cfg->sim.jitter_us, cfg->model_id, cfg->poisson ? "poisson" : "constant",
+            cfg->decode ? "true" : "false", BENCH_JPEG_SCALED ? "true" : "false", image_count, cfg->duration_s, cfg->warmup_s, cfg->drain_s, cfg->slo_ms,
+            (unsigned long long)cfg->seed);
+
+    fprintf(fp, "  \"runs\": [\n");
+    for (i = 0; i < res_count; i++) {
+        const struct bench_result_s *r = &res[i];
+
+        fprintf(fp, "    {\"offered_rps\": %.3f, \"arrived_rps\": %.3f, \"achieved_rps\": %.3f, \"requests\": %d, "
+                    "\"ok\": %d, \"errors\": %d, \"unfinished\": %d, \"saturated\": %s, ",
+                r->offered_rps, r->arrived_rps, r->achieved_rps, r->requests, r->ok, r->errors, r->unfinished,
+                r->saturated ? "true" : "false");
+        json_pcts(fp, "latency_ms", r->lat_ms);
+        fprintf(fp, ", ");
+        json_pcts(fp, "queue_ms", r->queue_ms);
+        fprintf(fp, ", ");
+        json_pcts(fp, "service_ms", r->service_ms);
+        fprintf(fp, ", \"stages\": {");
+        for (s = 0; s < STAGE_NUM; s++)
+            fprintf(fp, "%s\"%s\": {\"cpu_ms\": %.4f, \"wall_ms\": %.4f, \"cpu_util\": %.4f}", s ? ", " : "",
+                    stage_name[s], r->stage_cpu_ms[s], r->stage_wall_ms[s], r->stage_util[s]);
+        fprintf(fp, "}, \"process_cpu_util\": %.4f}%s\n", r->process_util, i + 1 < res_count ? "," : "");
+    }
+    fprintf(fp, "  ],\n");
+
+    if (knee >= 0)
+        fprintf(fp, "  \"knee\": {\"rps\": %.3f, \"bounded\": %s}\n}\n", res[knee].offered_rps,
+                knee + 1 < res_count ? "true" : "false");
+    else
+        fprintf(fp, "  \"knee\": null\n}\n");
+
+    fclose(fp);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Setup
+ * ------------------------------------------------------------------------------------------- */
+
+static int load_images(const char *dir, int keep_bytes, std::vector<bench_image_s> &images)
+{
+    static const char *exts[] = { ".bmp", ".jpg", ".jpeg", ".png" };
+    std::vector<cv::String> files;
+    size_t i, e;
+
+    cv::glob(std::string(dir) + "/*", files, false);
+    for (i = 0; i < files.size(); i++) {
+        std::string lower = files[i];
+        bench_image_s image;
+        FILE *fp;
+        long len;
+
+        for (e = 0; e < lower.size(); e++)
+            lower[e] = tolower(lower[e]);
+        for (e = 0; e < sizeof(exts) / sizeof(exts[0]); e++) {
+            if (lower.size() > strlen(exts[e]) && lower.compare(lower.size() - strlen(exts[e]), std::string::npos, exts[e]) == 0)
+                break;
+        }
+        if (e == sizeof(exts) / sizeof(exts[0]))
+            continue;
+
+        fp = fopen(files[i].c_str(), "rb");
+        if (fp == NULL)
+            continue;
+        fseek(fp, 0, SEEK_END);
+        len = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        image.bytes.resize(len);
+        if (fread(image.bytes.data(), 1, len, fp) != (size_t)len) {
+            fclose(fp);
+            continue;
+        }
+        fclose(fp);
+
+        /* same decoder as -D, so both modes preprocess the same pixels */
+        image.bgr = decode_image(image.bytes);
+        if (image.bgr.empty())
+            continue;
+        if (keep_bytes) {
+            image.bgr.release();
+        } else {
+            image.bgr = image.bgr.clone();
+            std::vector<uchar>().swap(image.bytes);
+        }
+        images.push_back(image);
+    }
+#if defined(HAVE_JPEG_INPUT)
+    jpeg_input_release();
+#endif
+    return images.empty() ? -1 : 0;
+}
+
+static int parse_rates(const char *arg, struct bench_cfg_s *cfg)
+{
+    double from, to, step, r;
+    char *end;
+
+    if (sscanf(arg, "%lf:%lf:%lf", &from, &to, &step) == 3) {
+        if (from <= 0 || step <= 0)
+            return -1;
+        for (r = from; r <= to + 1e-9 && cfg->rate_count < BENCH_RATE_MAX; r += step)
+            cfg->rates[cfg->rate_count++] = r;
+        return 0;
+    }
+
+    while (*arg && cfg->rate_count < BENCH_RATE_MAX) {
+        r = strtod(arg, &end);
+        if (end == arg || r <= 0)
+            return -1;
+        cfg->rates[cfg->rate_count++] = r;
+        arg = *end == ',' ? end + 1 : end;
+    }
+    return 0;
+}
+
+static int cmp_double(const void *pa, const void *pb)
+{
+    double a = *(const double *)pa, b = *(const double *)pb;
+    return a < b ? -1 : a > b;
+}
+
+static void usage(const char *prog)
+{
+    printf("usage: %s [options]\n"
+           "  -u N       use N KL520 over USB\n"
+           "  -S N       use N simulated devices (default 1 if no -u)\n"
+           "  -l us      simulated per-frame latency (default 10000)\n"
+           "  -j us      simulated latency jitter, +/- (default 0)\n"
+           "  -n path    NEF to upload (default %s)\n"
+           "  -m id      model id when compiling in toolchain (default 1)\n"
+           "  -i dir     image corpus, bmp/jpg/png (default ../../images)\n"
+           "  -r rates   offered rates in requests/s, 'a,b,c' or 'from:to:step'\n"
+           "             (default: 20%%..130%% of the capacity probed at start)\n"
+           "  -c         constant arrivals instead of Poisson\n"
+           "  -D         decode the image inside preprocess instead of at load (JPEG at reduced DCT scale)\n"
+           "  -t s       measured seconds per rate (default 10)\n"
+           "  -w s       warmup seconds per rate, not measured (default 1)\n"
+           "  -d s       drain budget after the last arrival (default: same as -t)\n"
+           "  -s ms      p99 latency objective used to find the knee (default none)\n"
+           "  -R seed    schedule seed (default 1)\n"
+           "  -o path    write results as JSON\n",
+           prog, DME_MODEL_FILE);
+}
+
+int main(int argc, char *argv[])
+{
+    struct bench_cfg_s cfg;
+    struct bench_worker_s workers[BENCH_DEV_MAX] = {};
+    struct bench_result_s results[BENCH_RATE_MAX];
+    struct kdp_dme_cfg_s dme_cfg;
+    std::vector<bench_image_s> images;
+    int usb_idx[BENCH_DEV_MAX];
+    int worker_count, opt, i, knee = -1, ret = 0;
+    uint64_t seed;
+    double capacity;
+
+    memset(&cfg, 0, sizeof(cfg));
+    kl520_sim_cfg_default(&cfg.sim);
+    cfg.image_dir = "../../images";
+    cfg.model_id = 1;
+    cfg.poisson = 1;
+    cfg.duration_s = 10;
+    cfg.warmup_s = 1;
+    cfg.drain_s = -1;
+    cfg.seed = 1;
+
+    while ((opt = getopt(argc, argv, "u:S:l:j:n:m:i:r:cDt:w:d:s:R:o:h")) != -1) {
+        switch (opt) {
+        case 'u': cfg.usb_count = atoi(optarg); break;
+        case 'S': cfg.sim_count = atoi(optarg); break;
+        case 'l': cfg.sim.frame_latency_us = atoi(optarg); break;
+        case 'j': cfg.sim.jitter_us = atoi(optarg); break;
+        case 'n': cfg.nef_path = optarg; break;
+        case 'm': cfg.model_id = atoi(optarg); break;
+        case 'i': cfg.image_dir = optarg; break;
+        case 'r':
+            if (parse_rates(optarg, &cfg) != 0) {
+                printf("bad rate list '%s'\n", optarg);
+                return -1;
+            }
+            break;
+        case 'c': cfg.poisson = 0; break;
+        case 'D': cfg.decode = 1; break;
+        case 't': cfg.duration_s = atof(optarg); break;
+        case 'w': cfg.warmup_s = atof(optarg); break;
+        case 'd': cfg.drain_s = atof(optarg); break;
+        case 's': cfg.slo_ms = atof(optarg); break;
+        case 'R': cfg.seed = strtoull(optarg, NULL, 0); break;
+        case 'o': cfg.json_path = optarg; break;
+        default: usage(argv[0]); return opt == 'h' ? 0 : -1;
+        }
+    }
+
+    if (cfg.usb_count == 0 && cfg.sim_count == 0)
+        cfg.sim_count = 1;
+    worker_count = cfg.usb_count ? cfg.usb_count : cfg.sim_count;
+    if (worker_count > BENCH_DEV_MAX || cfg.duration_s <= 0 || cfg.warmup_s < 0) {
+        usage(argv[0]);
+        return -1;
+    }
+    if (cfg.drain_s < 0)
+        cfg.drain_s = cfg.duration_s;
+    if (cfg.usb_count && cfg.nef_path == NULL)
+        cfg.nef_path = DME_MODEL_FILE;
+    seed = cfg.seed ? cfg.seed : 1;
+
+    if (load_images(cfg.image_dir, cfg.decode, images) != 0) {
+        printf("no readable images in '%s'\n", cfg.image_dir);
+        return -1;
+    }
+    printf("%d images from '%s'\n", (int)images.size(), cfg.image_dir);
+
+    if (cfg.usb_count && kl520_usb_open(cfg.usb_count, usb_idx) != 0)
+        return -1;
+
+    memset(&dme_cfg, 0, sizeof(dme_cfg));
+    dme_cfg.model_id     = cfg.model_id;
+    dme_cfg.output_num   = 1;
+    dme_cfg.image_col    = MODEL_IMG_W;
+    dme_cfg.image_row    = MODEL_IMG_H;
+    dme_cfg.image_ch     = 3;
+    dme_cfg.image_format = IMAGE_FORMAT_SUB128 | NPU_FORMAT_RGB565 | IMAGE_FORMAT_RAW_OUTPUT;
+
+    for (i = 0; i < worker_count; i++) {
+        struct bench_worker_s *w = &workers[i];
+        uint32_t ret_size = 0;
+
+        w->cfg = &cfg;
+        w->images = &images;
+        w->res = (char *)malloc(KL520_DEV_RES_SIZE);
+        w->res_float = (float *)malloc(KL520_DEV_RES_SIZE * sizeof(float));
+        w->dev = cfg.usb_count ? kl520_usb_device_create(usb_idx[i]) : kl520_sim_device_create(i, &cfg.sim);
+        if (w->dev == NULL || w->res == NULL || w->res_float == NULL) {
+            ret = -1;
+            goto out;
+        }
+
+        if (cfg.nef_path) {
+            if (kl520_dev_load_nef(w->dev, cfg.nef_path) != 0) {
+                ret = -1;
+                goto out;
+            }
+        } else {
+            char dummy_nef[1024] = {0};
+            w->dev->ops->start_dme(w->dev, dummy_nef, sizeof(dummy_nef), &ret_size);
+        }
+        if (w->dev->ops->dme_configure(w->dev, &dme_cfg, &w->model_id) != 0) {
+            printf("[%s] could not set to DME configure mode..\n", w->dev->name);
+            ret = -1;
+            goto out;
+        }
+    }
+
+    if (cfg.rate_count == 0) {
+        static const double fractions[] = { 0.2, 0.4, 0.6, 0.7, 0.8, 0.9, 1.0, 1.1, 1.2, 1.3 };
+
+        capacity = probe_capacity(workers, worker_count, images);
+        if (capacity <= 0) {
+            printf("capacity probe failed\n");
+            ret = -1;
+            goto out;
+        }
+        printf("probed capacity %.1f frames/s on %d %s device(s)\n", capacity, worker_count, cfg.usb_count ? "usb" : "sim");
+        for (i = 0; i < (int)(sizeof(fractions) / sizeof(fractions[0])); i++)
+            cfg.rates[cfg.rate_count++] = capacity * fractions[i];
+    }
+    qsort(cfg.rates, cfg.rate_count, sizeof(double), cmp_double);
+
+    printf("%s arrivals, %.1f s warmup + %.1f s measured per rate, latency from intended arrival\n",
+           cfg.poisson ? "poisson" : "constant", cfg.warmup_s, cfg.duration_s);
+    for (i = 0; i < cfg.rate_count; i++) {
+        if (bench_run(cfg.rates[i], &cfg, workers, worker_count, images, &seed, &results[i]) != 0) {
+            ret = -1;
+            goto out;
+        }
+        print_result(&results[i]);
+        if (results[i].errors)
+            ret = -1;
+        if (results[i].saturated)
+            break;
+        knee = i;
+    }
+    if (i == cfg.rate_count)
+        i--;
+
+    if (knee < 0)
+        printf("saturated already at %.1f rps (%s)\n", results[0].offered_rps, results[0].reason);
+    else if (knee + 1 < cfg.rate_count)
+        printf("saturation knee: %.1f rps sustained, %.1f rps not (%s)\n",
+               results[knee].offered_rps, results[knee + 1].offered_rps, results[knee + 1].reason);
+    else
+        printf("no saturation up to %.1f rps\n", results[knee].offered_rps);
+
+    if (cfg.json_path && write_json(cfg.json_path, &cfg, (int)images.size(), cfg.usb_count ? "usb" : "sim",
+                                    results, i + 1, knee) != 0)
+        ret = -1;
+
+out:
+    for (i = 0; i < worker_count; i++) {
+        if (workers[i].dev) {
+            workers[i].dev->ops->end_dme(workers[i].dev);
+            kl520_dev_destroy(workers[i].dev);
+        }
+        free(workers[i].res);
+        free(workers[i].res_float);
+    }
+    if (cfg.usb_count)
+        kl520_usb_close();
+    return ret;
+}
@@ -0,0 +1,210 @@
+/**
+ * @file        kl520_dme_multi_head.cpp
+ * @brief       Run one shared backbone on KL520 and many Dense heads on the host
+ * @version     0.1
+ * @date        2026-10-19
+ *
+ * The .nef only holds the backbone up to global average pooling (1280-d feature). Every classifier
+ * head exported by Python_validation/export_heads.py is evaluated on the host by dense_heads.c, as
+ * one packed GEMM over a batch of features instead of one .nef (and one NPU pass) per head.
+ */
+
+
+#include "errno.h"
+#include "kdp_host.h"
+#include "stdio.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include "user_util.h"
+#include "raw_output.h"
+#include "dense_heads.h"
+
+#include "opencv2/imgproc/imgproc.hpp"
+#include <opencv2/highgui/highgui.hpp>
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+#define DME_MODEL_FILE      (HOST_LIB_DIR "/input_models/KL520/test_model/models_520.nef")
+#define HEADS_FILE          (HOST_LIB_DIR "/input_models/KL520/test_model/heads.bin")
+#define IMAGES_GLOB         "../../images/*.bmp"
+
+#define MODEL_IMG_W 224
+#define MODEL_IMG_H 224
+#define INFERENCE_IMG_SIZE (MODEL_IMG_W * MODEL_IMG_H * 2)
+#define INFERENCE_RES_SIZE (256 * 1024)
+
+#define HEADS_BATCH 16
+
+static double now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* Backbone feature of one image, dequantized into feature[in_dim] */
+static int get_feature(int dev_idx, uint32_t model_id, const cv::Mat &img, char *inf_res,
+                       float *feature, int in_dim)
+{
+    struct raw_output_node_s node;
+    cv::Mat img_resized, img565;
+    uint32_t inf_size = 0;
+    bool res_flag = true;
+    int ret;
+
+    if (img.cols != MODEL_IMG_W || img.rows != MODEL_IMG_H)
+        cv::resize(img, img_resized, cv::Size(MODEL_IMG_W, MODEL_IMG_H));
+    else
+        img_resized = img;
+    cvtColor(img_resized, img565, CV_BGR2BGR565);
+
+    ret = kdp_dme_inference(dev_idx, (char *)img565.data, INFERENCE_IMG_SIZE, &inf_size, &res_flag, inf_res, 0, model_id);
+    if (ret == -1) {
+        printf("could not set to DME inference mode..[error = %d]\n", ret);
+        return -1;
+    }
+    kdp_dme_retrieve_res(dev_idx, 0, inf_size, inf_res);
+
+    if (raw_output_parse(inf_res, inf_size, &node, 1) != 1 || raw_output_node_len(&node) != in_dim) {
+        printf("backbone output is not a %d-d feature\n", in_dim);
+        return -1;
+    }
+    raw_output_dequant(&node, feature);
+    return 0;
+}
+
+static void print_heads(const struct dense_heads_s *dh, const char *image, const float *y)
+{
+    int h, j, best;
+
+    printf("%s\n", image);
+    for (h = 0; h < dense_heads_count(dh); h++) {
+        const struct dense_head_info_s *info = dense_heads_info(dh, h);
+        const float *v = y + info->offset;
+
+        for (best = 0, j = 1; j < info->out_dim; j++) {
+            if (v[j] > v[best])
+                best = j;
+        }
+        printf("    %-20s top-1 %3d  %f\n", info->name, best, v[best]);
+    }
+}
+
+int user_test_dme(int dev_idx, struct kdp_dme_cfg_s dme_cfg)
+{
+    struct dense_heads_s *dh;
+    std::vector<cv::String> images;
+    uint32_t model_id = 0;
+    double t_backbone = 0, t_heads = 0, t0;
+    int in_dim, out_stride, n, i, done = 0, ret = -1;
+    float *x = NULL, *y = NULL;
+    char *inf_res = NULL;
+
+    dh = dense_heads_load(HEADS_FILE);
+    if (dh == NULL)
+        return -1;
+    in_dim = dense_heads_in_dim(dh);
+    out_stride = dense_heads_out_stride(dh);
+    printf("%d heads over a %d-d feature, %s kernel\n", dense_heads_count(dh), in_dim, dense_heads_isa());
+
+    if (1) {
+        printf("reading model NEF file from '%s'\n", DME_MODEL_FILE);
+
+        long model_size;
+        char *model_buf = read_file_to_buffer_auto_malloc(DME_MODEL_FILE, &model_size);
+        if (model_buf == NULL)
+            goto out;
+
+        printf("starting DME inference ...\n");
+        uint32_t ret_size = 0;
+        int ret = kdp_start_dme_ext(dev_idx, model_buf, model_size, &ret_size);
+        free(model_buf);
+        if (ret != 0) {
+            printf("could not set to DME mode:%d..\n", ret_size);
+            goto out;
+        }
+        printf("DME mode succeeded...\n");
+        usleep(SLEEP_TIME);
+    }
+
+    if (1) {
+        printf("starting DME configure ...\n");
+        int ret = kdp_dme_configure(dev_idx, (char *)&dme_cfg, sizeof(struct kdp_dme_cfg_s), &model_id);
+        if (ret != 0) {
+            printf("could not set to DME configure mode..\n");
+            goto end;
+        }
+        printf("DME configure model [%d] succeeded...\n", model_id);
+        usleep(SLEEP_TIME);
+    }
+
+    cv::glob(IMAGES_GLOB, images);
+    x = (float *)malloc(sizeof(float) * HEADS_BATCH * in_dim);
+    y = (float *)malloc(sizeof(float) * HEADS_BATCH * out_stride);
+    inf_res = (char *)malloc(INFERENCE_RES_SIZE);
+    if (x == NULL || y == NULL || inf_res == NULL) {
+        printf("could not allocate feature / result buffers..\n");
+        goto end;
+    }
+
+    while (done < (int)images.size()) {
+        n = (int)images.size() - done < HEADS_BATCH ? (int)images.size() - done : HEADS_BATCH;
+
+        t0 = now_ms();
+        for (i = 0; i < n; i++) {
+            cv::Mat img = cv::imread(images[done + i]);
+            if (img.empty() || get_feature(dev_idx, model_id, img, inf_res, x + i * in_dim, in_dim) != 0) {
+                printf("failed on '%s'\n", images[done + i].c_str());
+                goto end;
+            }
+        }
+        t_backbone += now_ms() - t0;
+
+        t0 = now_ms();
+        dense_heads_run(dh, x, n, y);
+        t_heads += now_ms() - t0;
+
+        for (i = 0; i < n; i++)
+            print_heads(dh, images[done + i].c_str(), y + i * out_stride);
+        done += n;
+    }
+
+    printf("%d images: backbone %.2f ms/image on KL520, %d heads %.3f ms/image on host\n", done,
+           done ? t_backbone / done : 0, dense_heads_count(dh), done ? t_heads / done : 0);
+    ret = 0;
+
+end:
+    kdp_end_dme(dev_idx);
+out:
+    free(x);
+    free(y);
+    free(inf_res);
+    dense_heads_free(dh);
+    return ret;
+}
+
+int user_test(int dev_idx, int user_id)
+{
+    struct kdp_dme_cfg_s dme_cfg = create_dme_cfg_struct();
+
+    // dme configuration
+    dme_cfg.model_id     = 1;// model id when compiling the backbone in toolchain
+    dme_cfg.output_num   = 1;                             // the pooled feature
+    dme_cfg.image_col    = MODEL_IMG_W;
+    dme_cfg.image_row    = MODEL_IMG_H;
+    dme_cfg.image_ch     = 3;
+    dme_cfg.image_format = IMAGE_FORMAT_SUB128 | NPU_FORMAT_RGB565 | IMAGE_FORMAT_RAW_OUTPUT;
+
+    return user_test_dme(dev_idx, dme_cfg);
+}
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
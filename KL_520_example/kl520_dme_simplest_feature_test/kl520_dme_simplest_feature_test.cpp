@@ -20,6 +20,9 @@
 #include "kdpio.h"
 #include "ipc.h"
 #include "base.h"
+#if defined(HAVE_JPEG_INPUT)
+#include "jpeg_input.h"
+#endif
 
 #include "opencv2/imgproc/imgproc.hpp"
 #include <opencv2/highgui/highgui.hpp>
@@ -31,6 +34,30 @@ int post_processing_simplest(int model_id, struct kdp_image_s *image_p, float *r
 float get_float(int h, int w, int c, int image_p_h, int image_p_w, int image_p_c, float *res_float_array);
 }
 
+// JPEGs are decoded straight at a reduced DCT scale that still covers the model input,
+// everything else (and any JPEG libjpeg refuses) goes through cv::imread.
+static cv::Mat read_input_image(const char *path, int min_w, int min_h)
+{
+#if defined(HAVE_JPEG_INPUT)
+    int width, height, scale;
+    const uint8_t *bgr = jpeg_input_decode(path, min_w, min_h, &width, &height, &scale);
+
+    if (bgr != NULL) {
+        printf("decoded '%s' at %d/8 scale: %dx%d\n", path, scale, width, height);
+        return cv::Mat(height, width, CV_8UC3, (void *)bgr);
+    }
+#endif
+    return cv::imread(path);
+}
+
+// Free the JPEG decoder and the buffer the last read_input_image() result lives in
+static void release_input_image(void)
+{
+#if defined(HAVE_JPEG_INPUT)
+    jpeg_input_release();
+#endif
+}
+
 #if defined(__cplusplus) || defined(c_plusplus)
 extern "C" {
 #endif
@@ -45,6 +72,8 @@ extern "C" {
 #define MODEL_IMG_H 224
 #define INFERENCE_IMG_SIZE (MODEL_IMG_W * MODEL_IMG_H * 2)
 
+#define INPUT_IMG_FILE "../../images/img09.bmp"
+
 void get_detection_res(int dev_idx, uint32_t inf_size, struct post_parameter_s post_par)
 {
     char inf_res[256000];
@@ -161,11 +190,20 @@ int user_test_dme(int dev_idx, struct post_parameter_s post_par, \
         cv::Mat img, img_resized, img565;
         
         // img = cv::imread("../../images/birdman.bmp");
-        img = cv::imread("../../images/img09.bmp");
+        img = read_input_image(INPUT_IMG_FILE, MODEL_IMG_W, MODEL_IMG_H);
+        if (img.empty()) {
+            printf("could not read input image '%s'\n", INPUT_IMG_FILE);
+            release_input_image();
+            free(inf_res);
+            return -1;
+        }
 
         //image resize
-	    // cv::Size size(MODEL_IMG_W, MODEL_IMG_H);
-        
+        if (img.cols != MODEL_IMG_W || img.rows != MODEL_IMG_H) {
+            cv::Size size(MODEL_IMG_W, MODEL_IMG_H);
+            cv::resize(img, img_resized, size, 0, 0, cv::INTER_AREA);
+            img = img_resized;
+        }
 
         cvtColor(img, img565, CV_BGR2BGR565);
         IplImage ipl_img;
@@ -183,6 +221,7 @@ int user_test_dme(int dev_idx, struct post_parameter_s post_par, \
         // Return if not succeed after retry for 2 times.
         if (ret == -1) {
             printf("could not set to DME inference mode..[error = %d]\n", ret);
+            release_input_image();
             return -1;
         }
 
@@ -200,6 +239,7 @@ int user_test_dme(int dev_idx, struct post_parameter_s post_par, \
 	    while(!(cv::waitKey(10) > 0)){	
 	    }
 
+        release_input_image();
         free(inf_res);
     }
     return 0;
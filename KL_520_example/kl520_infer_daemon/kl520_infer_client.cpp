@@ -0,0 +1,274 @@
+/**
+ * @file        kl520_infer_client.cpp
+ * @brief       Client side of kl520_infer_daemon: shared memory ring + doorbell socket
+ * @version     0.1
+ * @date        2026-10-19
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "kl520_device.h"
+#include "kl520_infer_client.h"
+
+struct kl520_client_s {
+    int sock;
+    int mem_fd;
+    void *base;
+    struct kl520_ring_hdr_s hdr;
+    struct kl520_msg_hello_ack_s ack;
+    uint32_t next_slot;
+    uint64_t seq;
+};
+
+static int send_hello(int sock, int mem_fd, const struct kl520_msg_hello_s *hello)
+{
+    char ctrl[CMSG_SPACE(sizeof(int))];
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(ctrl, 0, sizeof(ctrl));
+    iov.iov_base = (void *)hello;
+    iov.iov_len = sizeof(*hello);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &mem_fd, sizeof(int));
+
+    return sendmsg(sock, &msg, MSG_NOSIGNAL) == (ssize_t)sizeof(*hello) ? 0 : -1;
+}
+
+struct kl520_client_s *kl520_client_connect(const struct kl520_client_cfg_s *cfg)
+{
+    const char *sock_path = cfg->sock_path ? cfg->sock_path : KL520_INFER_SOCK_PATH;
+    struct kl520_client_s *cl;
+    struct kl520_msg_hello_s hello;
+    struct sockaddr_un addr;
+    ssize_t n;
+
+    if (cfg->slot_count == 0 || cfg->slot_count > KL520_INFER_SLOT_MAX) {
+        printf("slot_count must be 1..%d\n", KL520_INFER_SLOT_MAX);
+        return NULL;
+    }
+
+    cl = (struct kl520_client_s *)calloc(1, sizeof(struct kl520_client_s));
+    if (cl == NULL)
+        return NULL;
+    cl->sock = -1;
+    cl->mem_fd = -1;
+    cl->base = MAP_FAILED;
+
+    kl520_ring_layout(&cl->hdr, cfg->slot_count, cfg->frame_size, cfg->res_size);
+
+    cl->mem_fd = memfd_create("kl520_infer_ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (cl->mem_fd < 0 || ftruncate(cl->mem_fd, cl->hdr.total_size) < 0 ||
+        fcntl(cl->mem_fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_SEAL) < 0) {
+        printf("could not create the shared memory ring: %s\n", strerror(errno));
+        goto fail;
+    }
+
+    cl->base = mmap(NULL, cl->hdr.total_size, PROT_READ | PROT_WRITE, MAP_SHARED, cl->mem_fd, 0);
+    if (cl->base == MAP_FAILED) {
+        printf("could not map the shared memory ring: %s\n", strerror(errno));
+        goto fail;
+    }
+    memcpy(cl->base, &cl->hdr, sizeof(cl->hdr));
+
+    cl->sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (cl->sock < 0)
+        goto fail;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, sock_path, sizeof(addr.sun_path) - 1);
+    if (connect(cl->sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        printf("could not connect to '%s': %s\n", sock_path, strerror(errno));
+        goto fail;
+    }
+
+    memset(&hello, 0, sizeof(hello));
+    hello.type = KL520_MSG_HELLO;
+    hello.magic = KL520_INFER_MAGIC;
+    hello.version = KL520_INFER_VERSION;
+    hello.priority = cfg->priority;
+    hello.weight = cfg->weight ? cfg->weight : 1;
+    hello.deadline_us = cfg->deadline_us;
+
+    if (send_hello(cl->sock, cl->mem_fd, &hello) < 0) {
+        printf("could not send hello: %s\n", strerror(errno));
+        goto fail;
+    }
+
+    n = recv(cl->sock, &cl->ack, sizeof(cl->ack), 0);
+    if (n != (ssize_t)sizeof(cl->ack) || cl->ack.type != KL520_MSG_HELLO_ACK || cl->ack.status != 0) {
+        printf("daemon rejected the connection\n");
+        goto fail;
+    }
+
+    /* the daemon holds its own reference now */
+    close(cl->mem_fd);
+    cl->mem_fd = -1;
+    return cl;
+
+fail:
+    kl520_client_close(cl);
+    return NULL;
+}
+
+void kl520_client_close(struct kl520_client_s *cl)
+{
+    if (cl == NULL)
+        return;
+    if (cl->sock >= 0)
+        close(cl->sock);
+    if (cl->base != MAP_FAILED)
+        munmap(cl->base, cl->hdr.total_size);
+    if (cl->mem_fd >= 0)
+        close(cl->mem_fd);
+    free(cl);
+}
+
+int kl520_client_models(struct kl520_client_s *cl, const uint32_t **model_id, const uint32_t **frame_len)
+{
+    if (model_id)
+        *model_id = cl->ack.model_id;
+    if (frame_len)
+        *frame_len = cl->ack.model_frame_len;
+    return cl->ack.model_count;
+}
+
+int kl520_client_acquire(struct kl520_client_s *cl)
+{
+    uint32_t i, slot;
+
+    for (i = 0; i < cl->hdr.slot_count; i++) {
+        slot = (cl->next_slot + i) % cl->hdr.slot_count;
+        if (kl520_slot_state(kl520_ring_slot(&cl->hdr, cl->base, slot)) == KL520_SLOT_FREE) {
+            cl->next_slot = (slot + 1) % cl->hdr.slot_count;
+            return slot;
+        }
+    }
+    return -1;
+}
+
+char *kl520_client_frame(struct kl520_client_s *cl, int slot)
+{
+    return kl520_ring_frame(&cl->hdr, cl->base, slot);
+}
+
+int kl520_client_submit(struct kl520_client_s *cl, int slot, uint32_t model_id, uint32_t frame_len,
+                        uint32_t deadline_us, int32_t priority)
+{
+    struct kl520_ring_slot_s *s = kl520_ring_slot(&cl->hdr, cl->base, slot);
+    char bell = KL520_DOORBELL_SUBMIT;
+
+    if (frame_len > cl->hdr.frame_size)
+        return -1;
+
+    s->model_id = model_id;
+    s->frame_len = frame_len;
+    s->priority = priority;
+    s->deadline_ns = deadline_us ? kl520_mono_ns() + (uint64_t)deadline_us * 1000 : 0;
+    s->seq = cl->seq++;
+    s->status = 0;
+    s->res_len = 0;
+    kl520_slot_set_state(s, KL520_SLOT_SUBMITTED);
+
+    /* EAGAIN: the daemon has doorbells pending already */
+    if (send(cl->sock, &bell, 1, MSG_DONTWAIT | MSG_NOSIGNAL) < 0 && errno != EAGAIN)
+        return -1;
+    return 0;
+}
+
+static int find_done(struct kl520_client_s *cl)
+{
+    struct kl520_ring_slot_s *s;
+    uint64_t best_seq = 0;
+    int best = -1;
+    uint32_t i;
+
+    for (i = 0; i < cl->hdr.slot_count; i++) {
+        s = kl520_ring_slot(&cl->hdr, cl->base, i);
+        if (kl520_slot_state(s) == KL520_SLOT_DONE && (best < 0 || s->seq < best_seq)) {
+            best = i;
+            best_seq = s->seq;
+        }
+    }
+    return best;
+}
+
+int kl520_client_wait(struct kl520_client_s *cl, int timeout_ms)
+{
+    uint64_t t_end = timeout_ms >= 0 ? kl520_mono_ns() + (uint64_t)timeout_ms * 1000000 : 0;
+    struct pollfd pfd;
+    char bells[64];
+    int slot, wait_ms;
+
+    for (;;) {
+        slot = find_done(cl);
+        if (slot >= 0)
+            return slot;
+
+        wait_ms = -1;
+        if (timeout_ms >= 0) {
+            uint64_t now = kl520_mono_ns();
+            if (now >= t_end)
+                return -1;
+            wait_ms = (int)((t_end - now + 999999) / 1000000);
+        }
+
+        pfd.fd = cl->sock;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, wait_ms) < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (pfd.revents & (POLLHUP | POLLERR)) {
+            slot = find_done(cl);
+            return slot >= 0 ? slot : KL520_CLIENT_DISCONNECTED;
+        }
+        if (pfd.revents & POLLIN) {
+            while (recv(cl->sock, bells, sizeof(bells), MSG_DONTWAIT) > 0) {
+            }
+        }
+    }
+}
+
+const char *kl520_client_result(struct kl520_client_s *cl, int slot, uint32_t *res_len, int32_t *status)
+{
+    struct kl520_ring_slot_s *s = kl520_ring_slot(&cl->hdr, cl->base, slot);
+
+    if (res_len)
+        *res_len = s->res_len;
+    if (status)
+        *status = s->status;
+    return kl520_ring_res(&cl->hdr, cl->base, slot);
+}
+
+const struct kl520_ring_slot_s *kl520_client_slot(struct kl520_client_s *cl, int slot)
+{
+    return kl520_ring_slot(&cl->hdr, cl->base, slot);
+}
+
+void kl520_client_release(struct kl520_client_s *cl, int slot)
+{
+    kl520_slot_set_state(kl520_ring_slot(&cl->hdr, cl->base, slot), KL520_SLOT_FREE);
+}
@@ -0,0 +1,59 @@
+/**
+ * @file        kl520_infer_client.h
+ * @brief       Client side of kl520_infer_daemon: shared memory ring + doorbell socket
+ * @version     0.1
+ * @date        2026-10-19
+ */
+
+#ifndef __KL520_INFER_CLIENT_H__
+#define __KL520_INFER_CLIENT_H__
+
+#include <stdint.h>
+#include "kl520_infer_ipc.h"
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+struct kl520_client_s;
+
+struct kl520_client_cfg_s {
+    const char *sock_path;          /* NULL: KL520_INFER_SOCK_PATH */
+    uint32_t slot_count;            /* frames in flight, <= KL520_INFER_SLOT_MAX */
+    uint32_t frame_size;            /* largest frame, e.g. 224 * 224 * 2 */
+    uint32_t res_size;              /* largest kdp_dme_retrieve_res() result */
+    int32_t priority;               /* higher runs first */
+    uint32_t weight;                /* device share among clients of the same priority, >= 1 */
+    uint32_t deadline_us;           /* default relative deadline per frame, 0: none */
+};
+
+struct kl520_client_s *kl520_client_connect(const struct kl520_client_cfg_s *cfg);
+void kl520_client_close(struct kl520_client_s *cl);
+
+/* Models the daemon serves: count, and the input frame length each one expects */
+int kl520_client_models(struct kl520_client_s *cl, const uint32_t **model_id, const uint32_t **frame_len);
+
+/* Take a free slot (-1 if all are in flight) and fill its frame in place */
+int kl520_client_acquire(struct kl520_client_s *cl);
+char *kl520_client_frame(struct kl520_client_s *cl, int slot);
+
+/* Hand the slot to the daemon. deadline_us == 0 and priority < 0 use the connection defaults. */
+int kl520_client_submit(struct kl520_client_s *cl, int slot, uint32_t model_id, uint32_t frame_len,
+                        uint32_t deadline_us, int32_t priority);
+
+#define KL520_CLIENT_DISCONNECTED   (-2)
+
+/* Oldest completed slot, waiting up to timeout_ms (-1: forever). Returns -1 on timeout or error,
+ * KL520_CLIENT_DISCONNECTED once the daemon has hung up and no completed slot is left. */
+int kl520_client_wait(struct kl520_client_s *cl, int timeout_ms);
+
+/* Result of a completed slot, valid until kl520_client_release() */
+const char *kl520_client_result(struct kl520_client_s *cl, int slot, uint32_t *res_len, int32_t *status);
+const struct kl520_ring_slot_s *kl520_client_slot(struct kl520_client_s *cl, int slot);
+void kl520_client_release(struct kl520_client_s *cl, int slot);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,244 @@
+/**
+ * @file        kl520_infer_client_demo.cpp
+ * @brief       Drive kl520_infer_daemon from one or more client processes and report latency
+ * @version     0.1
+ * @date        2026-10-19
+ *
+ * e.g. two services sharing one simulated dongle, one of them latency critical:
+ *
+ *   ./kl520_infer_daemon -S 1 -l 8000 &
+ *   ./kl520_infer_client_demo -c 1 -n 300 -r 30 -p 1 -d 50000 -v &
+ *   ./kl520_infer_client_demo -c 3 -n 300 -q 16 -v
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "kl520_device.h"
+#include "kl520_infer_client.h"
+#include "raw_output.h"
+
+#define DEMO_RES_SIZE           (64 * 1024)
+
+struct demo_cfg_s {
+    struct kl520_client_cfg_s client;
+    uint32_t model_id;
+    int frames;
+    int fps;                /* 0: keep every slot busy */
+    int verify;             /* results must match kl520_sim_frame_signature() */
+};
+
+static int cmp_u64(const void *pa, const void *pb)
+{
+    uint64_t a = *(const uint64_t *)pa, b = *(const uint64_t *)pb;
+    return a < b ? -1 : a > b;
+}
+
+static double pct_ms(uint64_t *v, int n, double p)
+{
+    if (n == 0)
+        return 0;
+    return v[(int)((n - 1) * p)] / 1e6;
+}
+
+static void fill_frame(char *frame, uint32_t len, uint32_t seed)
+{
+    uint32_t i, x = seed * 2654435761u + 1;
+
+    for (i = 0; i + 4 <= len; i += 4) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        memcpy(frame + i, &x, 4);
+    }
+}
+
+static int check_result(const char *res, uint32_t res_len, uint32_t sig)
+{
+    struct raw_output_node_s node;
+    int c;
+
+    if (raw_output_parse(res, res_len, &node, 1) != 1)
+        return -1;
+    for (c = 0; c < node.channel; c++) {
+        if (node.data[c * 16] != (int8_t)((sig >> (c % 24)) & 0x7f))
+            return -1;
+    }
+    return 0;
+}
+
+static int run_client(int client_no, const struct demo_cfg_s *cfg)
+{
+    struct kl520_client_s *cl;
+    const uint32_t *model_id, *model_frame_len;
+    uint64_t *lat, *queue, *service, t_next, interval_ns;
+    uint64_t t_submit[KL520_INFER_SLOT_MAX];
+    uint32_t sig[KL520_INFER_SLOT_MAX];
+    uint32_t frame_len = 0;
+    int submitted = 0, finished = 0, ok = 0, expired = 0, failed = 0, mismatch = 0;
+    int i, slot, model_count;
+    uint64_t t0;
+
+    cl = kl520_client_connect(&cfg->client);
+    if (cl == NULL)
+        return -1;
+
+    model_count = kl520_client_models(cl, &model_id, &model_frame_len);
+    for (i = 0; i < model_count; i++) {
+        if (model_id[i] == cfg->model_id)
+            frame_len = model_frame_len[i];
+    }
+    if (frame_len == 0) {
+        printf("[client %d] daemon does not serve model %u\n", client_no, cfg->model_id);
+        kl520_client_close(cl);
+        return -1;
+    }
+
+    lat = (uint64_t *)calloc(cfg->frames, sizeof(uint64_t));
+    queue = (uint64_t *)calloc(cfg->frames, sizeof(uint64_t));
+    service = (uint64_t *)calloc(cfg->frames, sizeof(uint64_t));
+    if (lat == NULL || queue == NULL || service == NULL) {
+        printf("[client %d] out of memory\n", client_no);
+        free(lat);
+        free(queue);
+        free(service);
+        kl520_client_close(cl);
+        return -1;
+    }
+
+    interval_ns = cfg->fps > 0 ? 1000000000ull / cfg->fps : 0;
+    t0 = t_next = kl520_mono_ns();
+
+    while (finished < cfg->frames) {
+        /* submit whatever is due and fits */
+        while (submitted < cfg->frames && kl520_mono_ns() >= t_next && (slot = kl520_client_acquire(cl)) >= 0) {
+            char *frame = kl520_client_frame(cl, slot);
+
+            fill_frame(frame, frame_len, (getpid() << 16) ^ submitted);
+            sig[slot] = cfg->verify ? kl520_sim_frame_signature(frame, frame_len) : 0;
+            t_submit[slot] = kl520_mono_ns();
+            if (kl520_client_submit(cl, slot, cfg->model_id, frame_len, 0, -1) != 0) {
+                printf("[client %d] submit failed\n", client_no);
+                finished = cfg->frames;
+                break;
+            }
+            submitted++;
+            t_next += interval_ns;
+        }
+
+        slot = kl520_client_wait(cl, interval_ns ? 1 : 1000);
+        if (slot == KL520_CLIENT_DISCONNECTED) {
+            printf("[client %d] daemon went away, %d frame(s) lost\n", client_no, submitted - finished);
+            failed += submitted - finished;
+            break;
+        }
+        if (slot < 0)
+            continue;
+
+        {
+            const struct kl520_ring_slot_s *s = kl520_client_slot(cl, slot);
+            uint32_t res_len;
+            int32_t status;
+            const char *res = kl520_client_result(cl, slot, &res_len, &status);
+
+            if (status == KL520_INFER_OK) {
+                lat[ok] = s->t_done_ns - t_submit[slot];
+                queue[ok] = s->t_start_ns - s->t_queued_ns;
+                service[ok] = s->t_done_ns - s->t_start_ns;
+                ok++;
+                if (cfg->verify && check_result(res, res_len, sig[slot]) != 0)
+                    mismatch++;
+            } else if (status == KL520_INFER_EXPIRED) {
+                expired++;
+            } else {
+                failed++;
+            }
+            kl520_client_release(cl, slot);
+            finished++;
+        }
+    }
+
+    qsort(lat, ok, sizeof(uint64_t), cmp_u64);
+    qsort(queue, ok, sizeof(uint64_t), cmp_u64);
+    qsort(service, ok, sizeof(uint64_t), cmp_u64);
+
+    printf("[client %d pid %d] %d ok, %d expired, %d failed, %d mismatched in %.2f s\n"
+           "    latency  p50 %.2f ms  p99 %.2f ms  max %.2f ms\n"
+           "    queueing p50 %.2f ms  p99 %.2f ms, device p50 %.2f ms\n",
+           client_no, (int)getpid(), ok, expired, failed, mismatch, (kl520_mono_ns() - t0) / 1e9,
+           pct_ms(lat, ok, 0.5), pct_ms(lat, ok, 0.99), pct_ms(lat, ok, 1.0),
+           pct_ms(queue, ok, 0.5), pct_ms(queue, ok, 0.99), pct_ms(service, ok, 0.5));
+
+    free(lat);
+    free(queue);
+    free(service);
+    kl520_client_close(cl);
+    return (failed || mismatch) ? -1 : 0;
+}
+
+static void usage(const char *prog)
+{
+    printf("usage: %s [options]\n"
+           "  -s path    daemon socket (default %s)\n"
+           "  -c N       client processes to fork (default 1)\n"
+           "  -n N       frames per client (default 100)\n"
+           "  -r fps     submit rate per client, 0: as fast as slots allow (default 0)\n"
+           "  -q N       ring slots = frames in flight (default 4)\n"
+           "  -m id      model id (default 1)\n"
+           "  -p prio    client priority (default 0)\n"
+           "  -w weight  client weight (default 1)\n"
+           "  -d us      per-frame deadline (default none)\n"
+           "  -v         verify results against the simulated device\n",
+           prog, KL520_INFER_SOCK_PATH);
+}
+
+int main(int argc, char *argv[])
+{
+    struct demo_cfg_s cfg;
+    int clients = 1, opt, i, status, ret = 0;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.client.slot_count = 4;
+    cfg.client.frame_size = 224 * 224 * 2;
+    cfg.client.res_size = DEMO_RES_SIZE;
+    cfg.client.weight = 1;
+    cfg.model_id = 1;
+    cfg.frames = 100;
+
+    while ((opt = getopt(argc, argv, "s:c:n:r:q:m:p:w:d:vh")) != -1) {
+        switch (opt) {
+        case 's': cfg.client.sock_path = optarg; break;
+        case 'c': clients = atoi(optarg); break;
+        case 'n': cfg.frames = atoi(optarg); break;
+        case 'r': cfg.fps = atoi(optarg); break;
+        case 'q': cfg.client.slot_count = atoi(optarg); break;
+        case 'm': cfg.model_id = atoi(optarg); break;
+        case 'p': cfg.client.priority = atoi(optarg); break;
+        case 'w': cfg.client.weight = atoi(optarg); break;
+        case 'd': cfg.client.deadline_us = atoi(optarg); break;
+        case 'v': cfg.verify = 1; break;
+        default: usage(argv[0]); return opt == 'h' ? 0 : -1;
+        }
+    }
+
+    if (clients <= 1)
+        return run_client(0, &cfg);
+
+    for (i = 0; i < clients; i++) {
+        if (fork() == 0) {
+            ret = run_client(i, &cfg);
+            fflush(stdout);
+            _exit(ret == 0 ? 0 : 1);
+        }
+    }
+    for (i = 0; i < clients; i++) {
+        wait(&status);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            ret = -1;
+    }
+    return ret;
+}
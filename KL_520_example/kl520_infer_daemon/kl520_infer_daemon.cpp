@@ -0,0 +1,894 @@
+/**
+ * @file        kl520_infer_daemon.cpp
+ * @brief       Local inference daemon: owns the KL520 devices and loaded models, and serves many
+ *              client processes through shared memory rings (see kl520_infer_ipc.h)
+ * @version     0.1
+ * @date        2026-10-19
+ *
+ * Scheduling, per device worker:
+ *  - a queued frame whose deadline cannot be met any more (now + estimated service time) is
+ *    completed as KL520_INFER_EXPIRED without touching the device;
+ *  - a client whose head frame is due within URGENT_FACTOR service times is urgent, and urgent
+ *    frames go first, earliest deadline first;
+ *  - otherwise the highest priority wins, and among equal priorities the client with the least
+ *    weighted device time (virtual time, start-time fair queuing) wins;
+ *  - adjacent frames are batched per model: while the device has run fewer than batch_max frames
+ *    in a row for its configured model, a queued frame for that model of at least the winner's
+ *    priority goes instead of a non-urgent winner for another model, saving a reconfigure.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "kl520_device.h"
+#include "kl520_infer_ipc.h"
+
+#define DAEMON_DEV_MAX          8
+#define DAEMON_CLIENT_MAX       64
+#define DAEMON_BATCH_MAX        32
+#define URGENT_FACTOR           2
+#define DEFAULT_EST_NS          (10 * 1000 * 1000ull)
+#define WEIGHT_SCALE            1024
+
+struct model_s {
+    uint32_t model_id;                      /* model id when compiling in toolchain */
+    struct kdp_dme_cfg_s dme_cfg;
+    uint32_t frame_len;
+    uint32_t dev_model_id[DAEMON_DEV_MAX];  /* what kdp_dme_configure() returned on each device */
+    uint64_t est_ns;                        /* EWMA of device time per frame, 0 until measured */
+};
+
+struct job_s {
+    int model_idx;
+    uint32_t frame_len;
+    int32_t priority;
+    uint64_t deadline_ns;
+    uint64_t seq;
+};
+
+struct client_s {
+    int sock;
+    uint32_t id;
+    int hello_done;
+    int alive;
+    int refs;                               /* connection + frames in flight on devices */
+
+    void *base;
+    struct kl520_ring_hdr_s hdr;
+    int32_t priority;
+    uint32_t weight;
+    uint64_t deadline_ns;                   /* default relative deadline */
+
+    uint64_t vtime;
+    struct job_s job[KL520_INFER_SLOT_MAX]; /* indexed by slot */
+    uint8_t owned[KL520_INFER_SLOT_MAX];    /* slot is queued or on a device; the ring state is client-writable */
+    uint32_t q[KL520_INFER_SLOT_MAX];       /* FIFO of queued slots */
+    uint32_t q_head;
+    uint32_t q_count;
+
+    uint64_t n_done;
+    uint64_t n_expired;
+    uint64_t n_error;
+};
+
+struct worker_s {
+    struct kl520_dev_s *dev;
+    int idx;
+    int cur_model;                          /* index into models, -1: not configured */
+    int offline;                            /* taken out of scheduling after a failed recovery */
+    int run_len;                            /* frames in a row for cur_model */
+    pthread_t thread;
+    uint64_t n_frames;
+    uint64_t n_batches;
+    uint64_t n_switches;
+    uint64_t busy_ns;
+};
+
+struct daemon_s {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    volatile sig_atomic_t stop;
+
+    const char *sock_path;
+    int listen_fd;
+    uint32_t next_client_id;
+    struct client_s *clients[DAEMON_CLIENT_MAX];
+    int client_count;
+
+    struct model_s models[KL520_INFER_MODEL_MAX];
+    int model_count;
+
+    const char *nef_path;                   /* NULL: simulated devices */
+    struct worker_s workers[DAEMON_DEV_MAX];
+    int worker_count;
+    int workers_up;                         /* workers not offline */
+    int batch_max;
+};
+
+static struct daemon_s g_daemon;
+
+static void on_signal(int sig)
+{
+    g_daemon.stop = 1;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Clients
+ * ------------------------------------------------------------------------------------------- */
+
+static void doorbell(struct client_s *cl)
+{
+    char bell = KL520_DOORBELL_DONE;
+
+    /* EAGAIN: the client has doorbells pending already */
+    send(cl->sock, &bell, 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+/* Publish a result; call with the lock held (the socket is only closed under it) */
+static void complete_slot(struct client_s *cl, uint32_t slot, int32_t status, uint32_t res_len)
+{
+    struct kl520_ring_slot_s *s = kl520_ring_slot(&cl->hdr, cl->base, slot);
+
+    cl->owned[slot] = 0;
+    s->status = status;
+    s->res_len = res_len;
+
+    if (status == KL520_INFER_OK)
+        cl->n_done++;
+    else if (status == KL520_INFER_EXPIRED)
+        cl->n_expired++;
+    else
+        cl->n_error++;
+
+    if (cl->alive) {
+        kl520_slot_set_state(s, KL520_SLOT_DONE);
+        doorbell(cl);
+    }
+}
+
+/* Fail a frame that never reached a device; it starts and ends now */
+static void fail_slot(struct client_s *cl, uint32_t slot, int32_t status)
+{
+    struct kl520_ring_slot_s *s = kl520_ring_slot(&cl->hdr, cl->base, slot);
+
+    s->t_start_ns = s->t_done_ns = kl520_mono_ns();
+    complete_slot(cl, slot, status, 0);
+}
+
+static void client_put(struct daemon_s *d, struct client_s *cl)
+{
+    int i;
+
+    if (--cl->refs > 0)
+        return;
+
+    for (i = 0; i < d->client_count; i++) {
+        if (d->clients[i] == cl) {
+            d->clients[i] = d->clients[--d->client_count];
+            break;
+        }
+    }
+
+    printf("client %u gone: %llu done, %llu expired, %llu failed\n", cl->id,
+           (unsigned long long)cl->n_done, (unsigned long long)cl->n_expired, (unsigned long long)cl->n_error);
+
+    if (cl->base)
+        munmap(cl->base, cl->hdr.total_size);
+    close(cl->sock);
+    free(cl);
+}
+
+static void client_disconnect(struct daemon_s *d, struct client_s *cl)
+{
+    if (!cl->alive)
+        return;
+    cl->alive = 0;
+    cl->q_count = 0;    /* queued frames are simply dropped, in-flight ones finish */
+    client_put(d, cl);
+}
+
+static int min_active_vtime(struct daemon_s *d, uint64_t *vtime)
+{
+    int i, found = 0;
+
+    for (i = 0; i < d->client_count; i++) {
+        struct client_s *cl = d->clients[i];
+        if (cl->alive && cl->q_count && (!found || cl->vtime < *vtime)) {
+            *vtime = cl->vtime;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+static int find_model(struct daemon_s *d, uint32_t model_id)
+{
+    int i;
+
+    for (i = 0; i < d->model_count; i++) {
+        if (d->models[i].model_id == model_id)
+            return i;
+    }
+    return -1;
+}
+
+static int handle_hello(struct daemon_s *d, struct client_s *cl)
+{
+    struct kl520_msg_hello_ack_s ack;
+    struct kl520_msg_hello_s hello;
+    struct kl520_ring_hdr_s hdr, expect;
+    char ctrl[CMSG_SPACE(sizeof(int))];
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    struct stat st;
+    int mem_fd = -1, seals, i;
+    void *base = MAP_FAILED;
+    ssize_t n;
+
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base = &hello;
+    iov.iov_len = sizeof(hello);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+
+    n = recvmsg(cl->sock, &msg, MSG_CMSG_CLOEXEC);
+    if (n <= 0)
+        return -1;
+
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            memcpy(&mem_fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+
+    memset(&ack, 0, sizeof(ack));
+    ack.type = KL520_MSG_HELLO_ACK;
+    ack.status = -1;
+
+    if (n != (ssize_t)sizeof(hello) || hello.type != KL520_MSG_HELLO || hello.magic != KL520_INFER_MAGIC ||
+        hello.version != KL520_INFER_VERSION || mem_fd < 0)
+        goto reply;
+
+    /* the ring must not be able to shrink under us, and must be as large as its header says */
+    seals = fcntl(mem_fd, F_GET_SEALS);
+    if (seals < 0 || !(seals & F_SEAL_SHRINK) || fstat(mem_fd, &st) < 0 || st.st_size < (off_t)sizeof(hdr))
+        goto reply;
+    if (pread(mem_fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr))
+        goto reply;
+    if (hdr.slot_count == 0 || hdr.slot_count > KL520_INFER_SLOT_MAX)
+        goto reply;
+    kl520_ring_layout(&expect, hdr.slot_count, hdr.frame_size, hdr.res_size);
+    if (memcmp(&expect, &hdr, sizeof(hdr)) != 0 || (uint64_t)st.st_size < hdr.total_size)
+        goto reply;
+
+    base = mmap(NULL, hdr.total_size, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, 0);
+    if (base == MAP_FAILED)
+        goto reply;
+
+    pthread_mutex_lock(&d->lock);
+    cl->base = base;
+    cl->hdr = expect;
+    cl->priority = hello.priority;
+    cl->weight = hello.weight ? hello.weight : 1;
+    cl->deadline_ns = (uint64_t)hello.deadline_us * 1000;
+    if (!min_active_vtime(d, &cl->vtime))
+        cl->vtime = 0;
+    cl->hello_done = 1;
+    pthread_mutex_unlock(&d->lock);
+
+    ack.status = 0;
+    ack.client_id = cl->id;
+    ack.model_count = d->model_count;
+    for (i = 0; i < d->model_count; i++) {
+        ack.model_id[i] = d->models[i].model_id;
+        ack.model_frame_len[i] = d->models[i].frame_len;
+    }
+
+    printf("client %u connected: %u slots, priority %d, weight %u, deadline %u us\n",
+           cl->id, hdr.slot_count, hello.priority, cl->weight, hello.deadline_us);
+
+reply:
+    if (mem_fd >= 0)
+        close(mem_fd);
+    send(cl->sock, &ack, sizeof(ack), MSG_NOSIGNAL);
+    return ack.status;
+}
+
+/* Move every SUBMITTED slot of the client into its queue, in submit order.
+ * Slots the daemon already owns are skipped whatever the client wrote into their state. */
+static void collect_submissions(struct daemon_s *d, struct client_s *cl)
+{
+    uint32_t fresh[KL520_INFER_SLOT_MAX];
+    uint32_t n = 0, i, j;
+    uint64_t now = kl520_mono_ns();
+    uint64_t vmin = 0;
+
+    pthread_mutex_lock(&d->lock);
+    for (i = 0; i < cl->hdr.slot_count; i++) {
+        struct kl520_ring_slot_s *s = kl520_ring_slot(&cl->hdr, cl->base, i);
+        uint32_t expected = KL520_SLOT_SUBMITTED;
+
+        if (cl->owned[i])
+            continue;
+        if (__atomic_compare_exchange_n(&s->state, &expected, (uint32_t)KL520_SLOT_QUEUED, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            struct job_s *job = &cl->job[i];
+
+            cl->owned[i] = 1;
+            /* copy everything out of shared memory once */
+            job->model_idx = find_model(d, s->model_id);
+            job->frame_len = s->frame_len;
+            job->priority = s->priority >= 0 ? s->priority : cl->priority;
+            job->deadline_ns = s->deadline_ns ? s->deadline_ns : (cl->deadline_ns ? now + cl->deadline_ns : 0);
+            job->seq = s->seq;
+            s->t_queued_ns = now;
+
+            /* insertion sort by seq, n is small */
+            for (j = n; j > 0 && cl->job[fresh[j - 1]].seq > job->seq; j--)
+                fresh[j] = fresh[j - 1];
+            fresh[j] = i;
+            n++;
+        }
+    }
+
+    if (n == 0) {
+        pthread_mutex_unlock(&d->lock);
+        return;
+    }
+
+    if (cl->q_count == 0 && min_active_vtime(d, &vmin) && cl->vtime < vmin)
+        cl->vtime = vmin;   /* no banking of credit while idle */
+
+    for (i = 0; i < n; i++) {
+        struct job_s *job = &cl->job[fresh[i]];
+
+        if (job->model_idx < 0)
+            fail_slot(cl, fresh[i], KL520_INFER_BAD_MODEL);
+        else if (job->frame_len != d->models[job->model_idx].frame_len || job->frame_len > cl->hdr.frame_size)
+            fail_slot(cl, fresh[i], KL520_INFER_BAD_FRAME);
+        else if (d->workers_up == 0)
+            fail_slot(cl, fresh[i], KL520_INFER_DEV_ERROR);
+        else {
+            assert(cl->q_count < KL520_INFER_SLOT_MAX);
+            cl->q[(cl->q_head + cl->q_count++) % KL520_INFER_SLOT_MAX] = fresh[i];
+        }
+    }
+    pthread_cond_broadcast(&d->cond);
+    pthread_mutex_unlock(&d->lock);
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Scheduler, called with the lock held
+ * ------------------------------------------------------------------------------------------- */
+
+static uint64_t model_est_ns(struct daemon_s *d, int model_idx)
+{
+    return d->models[model_idx].est_ns ? d->models[model_idx].est_ns : DEFAULT_EST_NS;
+}
+
+static struct job_s *head_job(struct client_s *cl, uint32_t *slot)
+{
+    *slot = cl->q[cl->q_head];
+    return &cl->job[*slot];
+}
+
+static void pop_head(struct client_s *cl)
+{
+    cl->q_head = (cl->q_head + 1) % KL520_INFER_SLOT_MAX;
+    cl->q_count--;
+}
+
+static void expire_heads(struct daemon_s *d, uint64_t now)
+{
+    struct job_s *job;
+    uint32_t slot;
+    int i;
+
+    for (i = 0; i < d->client_count; i++) {
+        struct client_s *cl = d->clients[i];
+
+        while (cl->alive && cl->q_count) {
+            job = head_job(cl, &slot);
+            if (!job->deadline_ns || job->deadline_ns >= now + model_est_ns(d, job->model_idx))
+                break;
+            pop_head(cl);
+            fail_slot(cl, slot, KL520_INFER_EXPIRED);
+        }
+    }
+}
+
+static int is_urgent(struct daemon_s *d, struct job_s *job, uint64_t now)
+{
+    return job->deadline_ns && job->deadline_ns < now + URGENT_FACTOR * model_est_ns(d, job->model_idx);
+}
+
+/* Does (a of ca) go before (b of cb)? */
+static int runs_before(struct daemon_s *d, uint64_t now, struct client_s *ca, struct job_s *a,
+                       struct client_s *cb, struct job_s *b)
+{
+    int ua = is_urgent(d, a, now), ub = is_urgent(d, b, now);
+
+    if (ua != ub)
+        return ua;
+    if (ua)
+        return a->deadline_ns < b->deadline_ns;
+    if (a->priority != b->priority)
+        return a->priority > b->priority;
+    return ca->vtime < cb->vtime;
+}
+
+/* Best queued head, optionally only for one model and at least one priority. Returns client index. */
+static int best_head(struct daemon_s *d, uint64_t now, int model_idx, int32_t min_priority)
+{
+    struct client_s *best_cl = NULL;
+    struct job_s *best = NULL, *job;
+    uint32_t slot;
+    int i, best_i = -1;
+
+    for (i = 0; i < d->client_count; i++) {
+        struct client_s *cl = d->clients[i];
+
+        if (!cl->alive || !cl->q_count)
+            continue;
+        job = head_job(cl, &slot);
+        if (model_idx >= 0 && (job->model_idx != model_idx || job->priority < min_priority))
+            continue;
+        if (best == NULL || runs_before(d, now, cl, job, best_cl, best)) {
+            best = job;
+            best_cl = cl;
+            best_i = i;
+        }
+    }
+    return best_i;
+}
+
+struct batch_item_s {
+    struct client_s *cl;
+    uint32_t slot;
+    struct job_s job;
+};
+
+/* Next frame for worker w. Frames are picked one at a time so a new urgent or higher priority frame
+ * never waits behind more than the frame already on the device. */
+static int pick_next(struct daemon_s *d, struct worker_s *w, struct batch_item_s *item)
+{
+    uint64_t now = kl520_mono_ns();
+    struct client_s *cl;
+    struct job_s *base;
+    uint32_t slot;
+    int i, alt;
+
+    expire_heads(d, now);
+
+    i = best_head(d, now, -1, 0);
+    if (i < 0)
+        return 0;
+
+    /* stay on the configured model while it has frames of the same or higher priority */
+    base = head_job(d->clients[i], &slot);
+    if (base->model_idx != w->cur_model && w->cur_model >= 0 && w->run_len < d->batch_max &&
+        !is_urgent(d, base, now)) {
+        alt = best_head(d, now, w->cur_model, base->priority);
+        if (alt >= 0)
+            i = alt;
+    }
+
+    cl = d->clients[i];
+    item->cl = cl;
+    item->job = *head_job(cl, &item->slot);
+    pop_head(cl);
+    cl->refs++;
+    cl->vtime += model_est_ns(d, item->job.model_idx) * WEIGHT_SCALE / cl->weight;
+
+    if (item->job.model_idx == w->cur_model && w->run_len < d->batch_max) {
+        w->run_len++;
+    } else {
+        w->run_len = 1;
+        w->n_batches++;
+    }
+    return 1;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Device workers
+ * ------------------------------------------------------------------------------------------- */
+
+static int load_models(struct daemon_s *d, struct worker_s *w)
+{
+    char dummy_nef[1024] = {0};
+    uint32_t ret_size = 0;
+
+    if (d->nef_path)
+        return kl520_dev_load_nef(w->dev, d->nef_path);
+    return w->dev->ops->start_dme(w->dev, dummy_nef, sizeof(dummy_nef), &ret_size);
+}
+
+static int switch_model(struct daemon_s *d, struct worker_s *w, int model_idx)
+{
+    struct model_s *m = &d->models[model_idx];
+    uint32_t dev_model_id = 0;
+
+    if (w->cur_model == model_idx)
+        return 0;
+
+    w->cur_model = -1;
+    if (w->dev->ops->dme_configure(w->dev, &m->dme_cfg, &dev_model_id) != 0) {
+        printf("[%s] could not set to DME configure mode for model %u, resetting..\n", w->dev->name, m->model_id);
+        /* one soft reset and a fresh upload, then give up on the device */
+        if (w->dev->ops->reset(w->dev, 0) != 0 || load_models(d, w) != 0 ||
+            w->dev->ops->dme_configure(w->dev, &m->dme_cfg, &dev_model_id) != 0) {
+            printf("[%s] could not set to DME configure mode for model %u..\n", w->dev->name, m->model_id);
+            return -1;
+        }
+    }
+    m->dev_model_id[w->idx] = dev_model_id;
+    w->cur_model = model_idx;
+    w->n_switches++;
+    return 0;
+}
+
+/* Take w out of scheduling; with no device left, queued frames fail instead of waiting forever.
+ * Call with the lock held. */
+static void worker_offline(struct daemon_s *d, struct worker_s *w)
+{
+    uint32_t slot;
+    int i;
+
+    w->offline = 1;
+    d->workers_up--;
+    printf("[%s] taken out of scheduling, %d device(s) left\n", w->dev->name, d->workers_up);
+    if (d->workers_up > 0)
+        return;
+
+    for (i = 0; i < d->client_count; i++) {
+        struct client_s *cl = d->clients[i];
+
+        while (cl->q_count) {
+            head_job(cl, &slot);
+            pop_head(cl);
+            fail_slot(cl, slot, KL520_INFER_DEV_ERROR);
+        }
+    }
+}
+
+static void run_item(struct daemon_s *d, struct worker_s *w, struct batch_item_s *item)
+{
+    struct client_s *cl = item->cl;
+    struct kl520_ring_slot_s *s = kl520_ring_slot(&cl->hdr, cl->base, item->slot);
+    char *frame = kl520_ring_frame(&cl->hdr, cl->base, item->slot);
+    char *res = kl520_ring_res(&cl->hdr, cl->base, item->slot);
+    int model_idx = item->job.model_idx;
+    uint32_t inf_size = 0;
+    int32_t status = KL520_INFER_DEV_ERROR;
+    int switched;
+    uint64_t t_start, t_done;
+
+    t_start = kl520_mono_ns();
+    s->t_start_ns = t_start;
+
+    /* frames go to the device straight from the client's ring, results straight back into it */
+    switched = switch_model(d, w, model_idx) == 0;
+    if (switched &&
+        w->dev->ops->dme_inference(w->dev, frame, item->job.frame_len, &inf_size,
+                                   d->models[model_idx].dev_model_id[w->idx]) == 0 &&
+        inf_size <= cl->hdr.res_size &&
+        w->dev->ops->dme_retrieve_res(w->dev, inf_size, res) == 0)
+        status = KL520_INFER_OK;
+
+    t_done = kl520_mono_ns();
+    s->t_done_ns = t_done;
+    w->n_frames++;
+    w->busy_ns += t_done - t_start;
+
+    pthread_mutex_lock(&d->lock);
+    if (status == KL520_INFER_OK) {
+        struct model_s *m = &d->models[model_idx];
+        uint64_t sample = t_done - t_start;
+        m->est_ns = m->est_ns ? (m->est_ns * 7 + sample) / 8 : sample;
+    }
+    complete_slot(cl, item->slot, status, status == KL520_INFER_OK ? inf_size : 0);
+    client_put(d, cl);
+    if (!switched)
+        worker_offline(d, w);
+    pthread_mutex_unlock(&d->lock);
+}
+
+static void *worker_thread(void *arg)
+{
+    struct worker_s *w = (struct worker_s *)arg;
+    struct daemon_s *d = &g_daemon;
+    struct batch_item_s item;
+    int n;
+
+    for (;;) {
+        n = 0;
+        pthread_mutex_lock(&d->lock);
+        while (!d->stop && (n = pick_next(d, w, &item)) == 0)
+            pthread_cond_wait(&d->cond, &d->lock);
+        pthread_mutex_unlock(&d->lock);
+        if (n == 0)
+            break;
+
+        run_item(d, w, &item);
+        if (w->offline)
+            break;
+    }
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Event loop
+ * ------------------------------------------------------------------------------------------- */
+
+static int open_listen_socket(const char *path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void accept_client(struct daemon_s *d)
+{
+    struct client_s *cl;
+    int fd;
+
+    fd = accept4(d->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->client_count == DAEMON_CLIENT_MAX) {
+        pthread_mutex_unlock(&d->lock);
+        printf("too many clients\n");
+        close(fd);
+        return;
+    }
+
+    cl = (struct client_s *)calloc(1, sizeof(struct client_s));
+    if (cl == NULL) {
+        pthread_mutex_unlock(&d->lock);
+        close(fd);
+        return;
+    }
+    cl->sock = fd;
+    cl->id = d->next_client_id++;
+    cl->alive = 1;
+    cl->refs = 1;
+    d->clients[d->client_count++] = cl;
+    pthread_mutex_unlock(&d->lock);
+}
+
+static void event_loop(struct daemon_s *d)
+{
+    struct pollfd pfd[DAEMON_CLIENT_MAX + 1];
+    struct client_s *cl_of[DAEMON_CLIENT_MAX + 1];
+    char bells[64];
+    int n, i;
+
+    while (!d->stop) {
+        pfd[0].fd = d->listen_fd;
+        pfd[0].events = POLLIN;
+        n = 1;
+
+        pthread_mutex_lock(&d->lock);
+        for (i = 0; i < d->client_count; i++) {
+            if (!d->clients[i]->alive)
+                continue;
+            pfd[n].fd = d->clients[i]->sock;
+            pfd[n].events = POLLIN;
+            cl_of[n++] = d->clients[i];
+        }
+        pthread_mutex_unlock(&d->lock);
+
+        if (poll(pfd, n, 200) <= 0)
+            continue;
+
+        if (pfd[0].revents & POLLIN)
+            accept_client(d);
+
+        /* only this thread disconnects clients, so cl_of[] stays valid until here */
+        for (i = 1; i < n; i++) {
+            struct client_s *cl = cl_of[i];
+            ssize_t r = 0;
+
+            if (!pfd[i].revents)
+                continue;
+
+            if (!cl->hello_done) {
+                if (handle_hello(d, cl) != 0) {
+                    pthread_mutex_lock(&d->lock);
+                    client_disconnect(d, cl);
+                    pthread_mutex_unlock(&d->lock);
+                }
+                continue;
+            }
+
+            if (pfd[i].revents & POLLIN) {
+                while ((r = recv(cl->sock, bells, sizeof(bells), MSG_DONTWAIT)) > 0) {
+                }
+            }
+            if ((pfd[i].revents & (POLLHUP | POLLERR)) || r == 0) {
+                pthread_mutex_lock(&d->lock);
+                client_disconnect(d, cl);
+                pthread_mutex_unlock(&d->lock);
+                continue;
+            }
+            collect_submissions(d, cl);
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Setup
+ * ------------------------------------------------------------------------------------------- */
+
+/* "id[:WxH[:outputs]]", e.g. "1:224x224:1" */
+static int parse_model(const char *spec, struct model_s *m)
+{
+    int id, col = 224, row = 224, outputs = 1;
+
+    if (sscanf(spec, "%d:%dx%d:%d", &id, &col, &row, &outputs) < 1 || id <= 0 || col <= 0 || row <= 0)
+        return -1;
+
+    memset(m, 0, sizeof(*m));
+    m->model_id = id;
+    m->dme_cfg.model_id = id;
+    m->dme_cfg.output_num = outputs;
+    m->dme_cfg.image_col = col;
+    m->dme_cfg.image_row = row;
+    m->dme_cfg.image_ch = 3;
+    m->dme_cfg.image_format = IMAGE_FORMAT_SUB128 | NPU_FORMAT_RGB565 | IMAGE_FORMAT_RAW_OUTPUT;
+    m->frame_len = col * row * 2;
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    printf("usage: %s [options]\n"
+           "  -s path    unix socket (default %s)\n"
+           "  -n file    NEF to load on every device\n"
+           "  -m spec    model id[:WxH[:outputs]] served, repeatable (default 1:224x224:1)\n"
+           "  -u N       use N KL520 USB devices\n"
+           "  -S N       use N simulated devices instead\n"
+           "  -l us      simulated per-frame latency (default 10000)\n"
+           "  -j us      simulated latency jitter (default 0)\n"
+           "  -o ch      simulated output channels (default 15)\n"
+           "  -b N       max frames in a row for one model while others wait (default 8)\n",
+           prog, KL520_INFER_SOCK_PATH);
+}
+
+int main(int argc, char *argv[])
+{
+    struct daemon_s *d = &g_daemon;
+    struct kl520_sim_cfg_s sim_cfg;
+    const char *nef_path = NULL;
+    int usb_count = 0, sim_count = 0;
+    int dev_idx[DAEMON_DEV_MAX];
+    int opt, i;
+
+    kl520_sim_cfg_default(&sim_cfg);
+    pthread_mutex_init(&d->lock, NULL);
+    pthread_cond_init(&d->cond, NULL);
+    d->sock_path = KL520_INFER_SOCK_PATH;
+    d->batch_max = 8;
+
+    while ((opt = getopt(argc, argv, "s:n:m:u:S:l:j:o:b:h")) != -1) {
+        switch (opt) {
+        case 's': d->sock_path = optarg; break;
+        case 'n': nef_path = optarg; break;
+        case 'm':
+            if (d->model_count == KL520_INFER_MODEL_MAX || parse_model(optarg, &d->models[d->model_count]) < 0) {
+                printf("bad model spec '%s'\n", optarg);
+                return -1;
+            }
+            d->model_count++;
+            break;
+        case 'u': usb_count = atoi(optarg); break;
+        case 'S': sim_count = atoi(optarg); break;
+        case 'l': sim_cfg.frame_latency_us = atoi(optarg); break;
+        case 'j': sim_cfg.jitter_us = atoi(optarg); break;
+        case 'o': sim_cfg.output_ch = atoi(optarg); break;
+        case 'b': d->batch_max = atoi(optarg); break;
+        default: usage(argv[0]); return opt == 'h' ? 0 : -1;
+        }
+    }
+
+    if (d->model_count == 0)
+        parse_model("1", &d->models[d->model_count++]);
+    if (d->batch_max < 1 || d->batch_max > DAEMON_BATCH_MAX)
+        d->batch_max = d->batch_max < 1 ? 1 : DAEMON_BATCH_MAX;
+
+    d->worker_count = usb_count ? usb_count : sim_count;
+    if ((usb_count && sim_count) || d->worker_count <= 0 || d->worker_count > DAEMON_DEV_MAX) {
+        printf("use either -u or -S with 1..%d devices\n", DAEMON_DEV_MAX);
+        return -1;
+    }
+    if (usb_count && nef_path == NULL) {
+        printf("-n is required with KL520 devices\n");
+        return -1;
+    }
+
+    if (usb_count && kl520_usb_open(usb_count, dev_idx) != 0)
+        return -1;
+
+    d->nef_path = nef_path;
+    d->workers_up = d->worker_count;
+
+    for (i = 0; i < d->worker_count; i++) {
+        struct worker_s *w = &d->workers[i];
+
+        w->idx = i;
+        w->cur_model = -1;
+        w->dev = usb_count ? kl520_usb_device_create(dev_idx[i]) : kl520_sim_device_create(i, &sim_cfg);
+        if (w->dev == NULL)
+            return -1;
+
+        if (load_models(d, w) != 0 || switch_model(d, w, 0) != 0)
+            return -1;
+        printf("[%s] DME mode succeeded, model %u configured\n", w->dev->name, d->models[0].model_id);
+    }
+
+    d->listen_fd = open_listen_socket(d->sock_path);
+    if (d->listen_fd < 0) {
+        printf("could not listen on '%s': %s\n", d->sock_path, strerror(errno));
+        return -1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    for (i = 0; i < d->worker_count; i++)
+        pthread_create(&d->workers[i].thread, NULL, worker_thread, &d->workers[i]);
+
+    printf("serving %d model(s) on %d device(s) at '%s'\n", d->model_count, d->worker_count, d->sock_path);
+    event_loop(d);
+
+    pthread_mutex_lock(&d->lock);
+    pthread_cond_broadcast(&d->cond);
+    pthread_mutex_unlock(&d->lock);
+    for (i = 0; i < d->worker_count; i++) {
+        struct worker_s *w = &d->workers[i];
+
+        pthread_join(w->thread, NULL);
+        printf("[%s] %llu frames in %llu batches, %llu model switches, busy %.1f s\n", w->dev->name,
+               (unsigned long long)w->n_frames, (unsigned long long)w->n_batches,
+               (unsigned long long)w->n_switches, w->busy_ns / 1e9);
+        w->dev->ops->end_dme(w->dev);
+        kl520_dev_destroy(w->dev);
+    }
+    if (usb_count)
+        kl520_usb_close();
+
+    close(d->listen_fd);
+    unlink(d->sock_path);
+    return 0;
+}
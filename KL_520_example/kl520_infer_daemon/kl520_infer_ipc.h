@@ -0,0 +1,148 @@
+/**
+ * @file        kl520_infer_ipc.h
+ * @brief       Wire protocol between kl520_infer_daemon and its clients
+ * @version     0.1
+ * @date        2026-10-19
+ *
+ * A client creates one shared memory ring (memfd), hands the fd to the daemon over a
+ * SOCK_SEQPACKET unix socket, and from then on frames and results only live in that ring:
+ *
+ *   +------------------+---------------------------+---------------------+----------------------+
+ *   | kl520_ring_hdr_s | kl520_ring_slot_s x count | frame x count       | result x count       |
+ *   +------------------+---------------------------+---------------------+----------------------+
+ *
+ * Slot i owns frame i and result i. Its state moves FREE -> SUBMITTED (client) -> QUEUED (daemon)
+ * -> DONE (daemon) -> FREE (client), with every transition published by an atomic store.
+ * The socket only carries the HELLO handshake and 1-byte doorbells: 'S' after a submit, 'D' after a
+ * completion. A doorbell that does not fit in the socket buffer is dropped, since the peer already
+ * has unread doorbells and scans every slot when it wakes up.
+ *
+ * The client seals the memfd against shrinking (F_SEAL_SHRINK) so the daemon can never fault on it.
+ */
+
+#ifndef __KL520_INFER_IPC_H__
+#define __KL520_INFER_IPC_H__
+
+#include <stdint.h>
+
+#define KL520_INFER_SOCK_PATH       "/tmp/kl520_infer.sock"
+#define KL520_INFER_MAGIC           0x4b4c4952  /* "KLIR" */
+#define KL520_INFER_VERSION         1
+#define KL520_INFER_SLOT_MAX        256
+#define KL520_INFER_MODEL_MAX       16
+
+#define KL520_DOORBELL_SUBMIT       'S'
+#define KL520_DOORBELL_DONE         'D'
+
+enum kl520_slot_state_e {
+    KL520_SLOT_FREE = 0,
+    KL520_SLOT_SUBMITTED,
+    KL520_SLOT_QUEUED,
+    KL520_SLOT_DONE,
+};
+
+enum kl520_infer_status_e {
+    KL520_INFER_OK          = 0,
+    KL520_INFER_EXPIRED     = -1,   /* deadline could not be met, frame was not run */
+    KL520_INFER_BAD_MODEL   = -2,   /* model id not loaded by the daemon */
+    KL520_INFER_BAD_FRAME   = -3,   /* frame_len does not match the model input */
+    KL520_INFER_DEV_ERROR   = -4,   /* device failed the frame */
+};
+
+struct kl520_ring_slot_s {
+    uint32_t state;                 /* enum kl520_slot_state_e, only touched through __atomic builtins */
+    uint32_t model_id;
+    uint32_t frame_len;
+    int32_t priority;               /* < 0: use the client's priority */
+    uint64_t deadline_ns;           /* CLOCK_MONOTONIC, 0: use the client's default deadline */
+    uint64_t seq;                   /* submit order within the client */
+
+    /* written by the daemon before DONE */
+    int32_t status;                 /* enum kl520_infer_status_e */
+    uint32_t res_len;
+    uint64_t t_queued_ns;
+    uint64_t t_start_ns;
+    uint64_t t_done_ns;
+};
+
+struct kl520_ring_hdr_s {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t frame_size;
+    uint32_t res_size;
+    uint32_t reserved;
+    uint64_t slot_off;
+    uint64_t frame_off;
+    uint64_t res_off;
+    uint64_t total_size;
+};
+
+enum kl520_msg_type_e {
+    KL520_MSG_HELLO = 1,
+    KL520_MSG_HELLO_ACK,
+};
+
+/* client -> daemon, carries the ring memfd as SCM_RIGHTS */
+struct kl520_msg_hello_s {
+    uint32_t type;
+    uint32_t magic;
+    uint32_t version;
+    int32_t priority;               /* higher runs first */
+    uint32_t weight;                /* share of device time among clients of the same priority */
+    uint32_t deadline_us;           /* default relative deadline, 0: none */
+};
+
+/* daemon -> client */
+struct kl520_msg_hello_ack_s {
+    uint32_t type;
+    int32_t status;                 /* 0, or -1 if the ring was rejected */
+    uint32_t client_id;
+    uint32_t model_count;
+    uint32_t model_id[KL520_INFER_MODEL_MAX];
+    uint32_t model_frame_len[KL520_INFER_MODEL_MAX];
+};
+
+#define KL520_RING_ALIGN(x, a)      (((x) + (a) - 1) & ~((uint64_t)(a) - 1))
+
+static inline void kl520_ring_layout(struct kl520_ring_hdr_s *hdr, uint32_t slot_count, uint32_t frame_size, uint32_t res_size)
+{
+    hdr->magic = KL520_INFER_MAGIC;
+    hdr->version = KL520_INFER_VERSION;
+    hdr->slot_count = slot_count;
+    hdr->frame_size = (uint32_t)KL520_RING_ALIGN(frame_size, 64);
+    hdr->res_size = (uint32_t)KL520_RING_ALIGN(res_size, 64);
+    hdr->reserved = 0;
+    hdr->slot_off = KL520_RING_ALIGN(sizeof(struct kl520_ring_hdr_s), 64);
+    hdr->frame_off = KL520_RING_ALIGN(hdr->slot_off + (uint64_t)slot_count * sizeof(struct kl520_ring_slot_s), 4096);
+    hdr->res_off = KL520_RING_ALIGN(hdr->frame_off + (uint64_t)slot_count * hdr->frame_size, 4096);
+    hdr->total_size = KL520_RING_ALIGN(hdr->res_off + (uint64_t)slot_count * hdr->res_size, 4096);
+}
+
+/* Both sides address the ring through their own copy of the header, never the one in shared memory */
+static inline struct kl520_ring_slot_s *kl520_ring_slot(const struct kl520_ring_hdr_s *hdr, void *base, uint32_t i)
+{
+    return (struct kl520_ring_slot_s *)((char *)base + hdr->slot_off) + i;
+}
+
+static inline char *kl520_ring_frame(const struct kl520_ring_hdr_s *hdr, void *base, uint32_t i)
+{
+    return (char *)base + hdr->frame_off + (uint64_t)i * hdr->frame_size;
+}
+
+static inline char *kl520_ring_res(const struct kl520_ring_hdr_s *hdr, void *base, uint32_t i)
+{
+    return (char *)base + hdr->res_off + (uint64_t)i * hdr->res_size;
+}
+
+static inline uint32_t kl520_slot_state(struct kl520_ring_slot_s *slot)
+{
+    return __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+}
+
+static inline void kl520_slot_set_state(struct kl520_ring_slot_s *slot, uint32_t state)
+{
+    __atomic_store_n(&slot->state, state, __ATOMIC_RELEASE);
+}
+
+#endif
@@ -0,0 +1,602 @@
+/**
+ * @file        kl520_supervisor.cpp
+ * @brief       Supervised DME devices: deadlines, resubmission and recovery without a restart
+ * @version     0.1
+ * @date        2026-10-19
+ *
+ * One worker thread per device runs frames from a shared FIFO. The worker copies the frame into
+ * its own buffer and retrieves into its own result buffer, so a call that is abandoned (hung, or
+ * past the request deadline) never touches memory the caller already got back. A watchdog thread
+ * expires deadlines and takes frames away from calls running past call_timeout_ms.
+ *
+ * A hung call is not cancelled, host_lib has no way to: its worker stays blocked inside
+ * kdp_dme_inference() until host_lib's USB timeout makes it return, and only then resets the
+ * device. The other devices keep serving in the meantime.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "kl520_supervisor.h"
+
+#define SUP_WATCHDOG_TICK_MS    5
+#define SUP_DUMMY_NEF_SIZE      1024
+
+enum sup_dev_state_e {
+    SUP_DEV_UP = 0,
+    SUP_DEV_RECOVER,
+    SUP_DEV_DOWN,
+};
+
+struct sup_dev_s {
+    struct kl520_sup_s *sup;
+    struct kl520_dev_s *dev;
+    pthread_t thread;
+    int no;
+    int state;
+    uint32_t model_id;
+    struct kl520_sup_req_s *cur;    /* frame on the device, NULL once the watchdog took it away */
+    uint64_t t_call_ns;             /* start of the running call, 0: idle */
+    int hung;                       /* the watchdog gave up on the running call */
+    uint64_t t_fault_ns;
+    char *frame;
+    char *res;
+};
+
+struct kl520_sup_s {
+    struct kl520_sup_cfg_s cfg;
+    char *nef;
+    uint32_t nef_size;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    struct kl520_sup_req_s *head;
+    struct kl520_sup_req_s *tail;
+    struct sup_dev_s devs[KL520_SUP_DEV_MAX];
+    int dev_count;
+    pthread_t watchdog;
+    int started;
+    int stop;
+    struct kl520_sup_metrics_s m;
+};
+
+static void sleep_ms(uint32_t ms)
+{
+    struct timespec ts;
+
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000;
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+    }
+}
+
+void kl520_sup_cfg_default(struct kl520_sup_cfg_s *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->frame_size = 224 * 224 * 2;
+    cfg->call_timeout_ms = 1000;
+    cfg->deadline_ms = 0;
+    cfg->max_attempts = 3;
+    cfg->recover_attempts = 5;
+    cfg->recover_backoff_ms = 100;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Queue and completion, all with sup->lock held
+ * ------------------------------------------------------------------------------------------- */
+
+static void queue_push(struct kl520_sup_s *sup, struct kl520_sup_req_s *req, int front)
+{
+    if (front) {
+        req->next = sup->head;
+        sup->head = req;
+        if (sup->tail == NULL)
+            sup->tail = req;
+    } else {
+        req->next = NULL;
+        if (sup->tail)
+            sup->tail->next = req;
+        else
+            sup->head = req;
+        sup->tail = req;
+    }
+    pthread_cond_signal(&sup->work);
+}
+
+static struct kl520_sup_req_s *queue_pop(struct kl520_sup_s *sup)
+{
+    struct kl520_sup_req_s *req = sup->head;
+
+    if (req) {
+        sup->head = req->next;
+        if (sup->head == NULL)
+            sup->tail = NULL;
+        req->next = NULL;
+    }
+    return req;
+}
+
+static void complete(struct kl520_sup_s *sup, struct kl520_sup_req_s *req, int status)
+{
+    req->status = status;
+    req->t_done_ns = kl520_mono_ns();
+    if (status == KL520_SUP_OK)
+        sup->m.frames_ok++;
+    else if (status == KL520_SUP_DEADLINE)
+        sup->m.frames_deadline++;
+    else if (status == KL520_SUP_NO_DEVICE)
+        sup->m.frames_no_device++;
+    else if (status == KL520_SUP_BAD_REQUEST)
+        sup->m.frames_bad_request++;
+    else
+        sup->m.frames_failed++;
+    pthread_cond_broadcast(&sup->done);
+}
+
+/* the device running req failed: give the frame to the next free device, if it has tries left */
+static void resubmit(struct kl520_sup_s *sup, struct kl520_sup_req_s *req)
+{
+    if (req->attempts >= sup->cfg.max_attempts) {
+        complete(sup, req, KL520_SUP_FAILED);
+        return;
+    }
+    sup->m.resubmits++;
+    queue_push(sup, req, 1);
+}
+
+static void fail_queue(struct kl520_sup_s *sup, int status)
+{
+    struct kl520_sup_req_s *req;
+
+    while ((req = queue_pop(sup)) != NULL)
+        complete(sup, req, status);
+}
+
+static int devices_left(struct kl520_sup_s *sup)
+{
+    int i, n = 0;
+
+    for (i = 0; i < sup->dev_count; i++) {
+        if (sup->devs[i].state != SUP_DEV_DOWN)
+            n++;
+    }
+    return n;
+}
+
+static void take_down(struct kl520_sup_s *sup, struct sup_dev_s *d)
+{
+    if (d->state != SUP_DEV_UP)
+        return;
+    d->state = SUP_DEV_RECOVER;
+    d->t_fault_ns = kl520_mono_ns();
+    sup->m.devices_up--;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Recovery, in the device's own worker thread
+ * ------------------------------------------------------------------------------------------- */
+
+static int restore(struct sup_dev_s *d, int *reuploaded)
+{
+    struct kl520_sup_s *sup = d->sup;
+    struct kdp_dme_cfg_s dme_cfg = sup->cfg.dme_cfg;
+    uint32_t ret_size = 0;
+
+    *reuploaded = 0;
+    if (d->dev->ops->dme_configure(d->dev, &dme_cfg, &d->model_id) == 0)
+        return 0;
+
+    /* configure is refused when the firmware has no model: upload the cached NEF */
+    if (d->dev->ops->start_dme(d->dev, sup->nef, sup->nef_size, &ret_size) != 0)
+        return -1;
+    *reuploaded = 1;
+    dme_cfg = sup->cfg.dme_cfg;
+    return d->dev->ops->dme_configure(d->dev, &dme_cfg, &d->model_id);
+}
+
+static void recover(struct sup_dev_s *d)
+{
+    struct kl520_sup_s *sup = d->sup;
+    uint32_t backoff = sup->cfg.recover_backoff_ms;
+    int attempt, hard, ret, reuploaded = 0, ok = 0;
+    uint64_t ns;
+
+    for (attempt = 0; attempt < sup->cfg.recover_attempts && !ok; attempt++) {
+        /* soft reset first, it keeps the NEF if the device still has it; a failed soft reset goes
+         * straight to a hard one, only hard resets that fail back off before the next */
+        if (attempt > 1) {
+            sleep_ms(backoff);
+            backoff *= 2;
+        }
+        hard = attempt > 0;
+        ret = d->dev->ops->reset(d->dev, hard);
+        if (ret == KL520_DEV_RESET_UNSUPPORTED)
+            break;              /* a soft reset did not do it and nothing stronger is left */
+        ok = ret == 0 && restore(d, &reuploaded) == 0;
+
+        pthread_mutex_lock(&sup->lock);
+        if (hard)
+            sup->m.hard_resets++;
+        else
+            sup->m.soft_resets++;
+        if (ok) {
+            sup->m.reconfigures++;
+            sup->m.nef_reuploads += reuploaded;
+        }
+        if (sup->stop)
+            attempt = sup->cfg.recover_attempts;
+        pthread_mutex_unlock(&sup->lock);
+    }
+
+    pthread_mutex_lock(&sup->lock);
+    if (ok) {
+        ns = kl520_mono_ns() - d->t_fault_ns;
+        d->state = SUP_DEV_UP;
+        sup->m.devices_up++;
+        sup->m.recoveries++;
+        sup->m.recovery_ns_last = ns;
+        sup->m.recovery_ns_total += ns;
+        if (ns > sup->m.recovery_ns_max)
+            sup->m.recovery_ns_max = ns;
+        printf("[%s] recovered in %.1f ms%s\n", d->dev->name, ns / 1e6, reuploaded ? " (NEF uploaded again)" : "");
+    } else {
+        d->state = SUP_DEV_DOWN;
+        sup->m.recover_failures++;
+        printf("[%s] could not be recovered, taken out of service\n", d->dev->name);
+        if (devices_left(sup) == 0)
+            fail_queue(sup, KL520_SUP_NO_DEVICE);
+    }
+    pthread_cond_broadcast(&sup->work);
+    pthread_mutex_unlock(&sup->lock);
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * Threads
+ * ------------------------------------------------------------------------------------------- */
+
+static void *worker_thread(void *arg)
+{
+    struct sup_dev_s *d = (struct sup_dev_s *)arg;
+    struct kl520_sup_s *sup = d->sup;
+    struct kl520_sup_req_s *req;
+    uint32_t len, inf_size;
+    int ret;
+
+    pthread_mutex_lock(&sup->lock);
+    while (!sup->stop) {
+        if (d->state == SUP_DEV_DOWN)
+            break;
+        if (d->state == SUP_DEV_RECOVER) {
+            pthread_mutex_unlock(&sup->lock);
+            recover(d);
+            pthread_mutex_lock(&sup->lock);
+            continue;
+        }
+
+        req = queue_pop(sup);
+        if (req == NULL) {
+            pthread_cond_wait(&sup->work, &sup->lock);
+            continue;
+        }
+        if (req->deadline_ns && kl520_mono_ns() > req->deadline_ns) {
+            complete(sup, req, KL520_SUP_DEADLINE);
+            continue;
+        }
+
+        req->attempts++;
+        d->cur = req;
+        d->hung = 0;
+        len = req->buf_len;
+        memcpy(d->frame, req->img_buf, len);
+        d->t_call_ns = kl520_mono_ns();
+        pthread_mutex_unlock(&sup->lock);
+
+        inf_size = 0;
+        ret = d->dev->ops->dme_inference(d->dev, d->frame, len, &inf_size, d->model_id);
+        if (ret == 0 && inf_size > KL520_DEV_RES_SIZE)
+            ret = -1;
+        if (ret == 0)
+            ret = d->dev->ops->dme_retrieve_res(d->dev, inf_size, d->res);
+
+        pthread_mutex_lock(&sup->lock);
+        d->t_call_ns = 0;
+        req = d->cur;
+        d->cur = NULL;
+
+        if (d->hung)
+            continue;           /* the watchdog already resubmitted the frame and took the device down */
+
+        if (ret != 0) {
+            sup->m.call_errors++;
+            if (req)
+                resubmit(sup, req);
+            take_down(sup, d);
+            continue;
+        }
+
+        if (req == NULL)
+            continue;           /* past its deadline while on the device, nobody wants the result */
+        if (inf_size > req->res_size) {
+            complete(sup, req, KL520_SUP_BAD_REQUEST);
+            continue;
+        }
+        memcpy(req->res, d->res, inf_size);
+        req->res_len = inf_size;
+        req->dev_no = d->no;
+        complete(sup, req, KL520_SUP_OK);
+    }
+    pthread_mutex_unlock(&sup->lock);
+    return NULL;
+}
+
+static void *watchdog_thread(void *arg)
+{
+    struct kl520_sup_s *sup = (struct kl520_sup_s *)arg;
+    struct kl520_sup_req_s *req, *prev, *next;
+    uint64_t now, timeout_ns = (uint64_t)sup->cfg.call_timeout_ms * 1000000;
+    int i;
+
+    pthread_mutex_lock(&sup->lock);
+    while (!sup->stop) {
+        now = kl520_mono_ns();
+
+        for (i = 0; i < sup->dev_count; i++) {
+            struct sup_dev_s *d = &sup->devs[i];
+
+            if (d->t_call_ns && !d->hung && timeout_ns && now - d->t_call_ns > timeout_ns) {
+                printf("[%s] call running for %.0f ms, taking its frame away\n", d->dev->name, (now - d->t_call_ns) / 1e6);
+                d->hung = 1;
+                sup->m.call_timeouts++;
+                if (d->cur)
+                    resubmit(sup, d->cur);
+                d->cur = NULL;
+                take_down(sup, d);
+            }
+            if (d->cur && d->cur->deadline_ns && now > d->cur->deadline_ns) {
+                complete(sup, d->cur, KL520_SUP_DEADLINE);
+                d->cur = NULL;
+            }
+        }
+
+        for (prev = NULL, req = sup->head; req != NULL; req = next) {
+            next = req->next;
+            if (req->deadline_ns && now > req->deadline_ns) {
+                if (prev)
+                    prev->next = next;
+                else
+                    sup->head = next;
+                if (sup->tail == req)
+                    sup->tail = prev;
+                complete(sup, req, KL520_SUP_DEADLINE);
+            } else {
+                prev = req;
+            }
+        }
+
+        pthread_mutex_unlock(&sup->lock);
+        sleep_ms(SUP_WATCHDOG_TICK_MS);
+        pthread_mutex_lock(&sup->lock);
+    }
+    pthread_mutex_unlock(&sup->lock);
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------------------------------
+ * API
+ * ------------------------------------------------------------------------------------------- */
+
+static char *read_nef(const char *path, uint32_t *size)
+{
+    char *buf;
+    long len;
+    FILE *fp;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        printf("could not open NEF '%s'\n", path);
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    buf = (char *)malloc(len > 0 ? len : 1);
+    if (buf == NULL || fread(buf, 1, len, fp) != (size_t)len) {
+        printf("could not read NEF '%s'\n", path);
+        free(buf);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+    *size = (uint32_t)len;
+    return buf;
+}
+
+struct kl520_sup_s *kl520_sup_create(struct kl520_dev_s **devs, int count, const struct kl520_sup_cfg_s *cfg)
+{
+    struct kl520_sup_s *sup;
+    struct kdp_dme_cfg_s dme_cfg;
+    uint32_t ret_size;
+    int i;
+
+    if (count <= 0 || count > KL520_SUP_DEV_MAX)
+        goto err_devs;
+
+    sup = (struct kl520_sup_s *)calloc(1, sizeof(struct kl520_sup_s));
+    if (sup == NULL)
+        goto err_devs;
+    sup->cfg = *cfg;
+    if (sup->cfg.max_attempts < 1)
+        sup->cfg.max_attempts = 1;
+    if (sup->cfg.recover_attempts < 1)
+        sup->cfg.recover_attempts = 1;
+
+    if (cfg->nef_path) {
+        sup->nef = read_nef(cfg->nef_path, &sup->nef_size);
+    } else {
+        sup->nef = (char *)calloc(1, SUP_DUMMY_NEF_SIZE);
+        sup->nef_size = SUP_DUMMY_NEF_SIZE;
+    }
+    if (sup->nef == NULL) {
+        free(sup);
+        goto err_devs;
+    }
+
+    pthread_mutex_init(&sup->lock, NULL);
+    pthread_cond_init(&sup->work, NULL);
+    pthread_cond_init(&sup->done, NULL);
+    sup->dev_count = count;
+
+    for (i = 0; i < count; i++) {
+        struct sup_dev_s *d = &sup->devs[i];
+
+        d->sup = sup;
+        d->dev = devs[i];
+        d->no = i;
+        d->frame = (char *)malloc(sup->cfg.frame_size);
+        d->res = (char *)malloc(KL520_DEV_RES_SIZE);
+
+        dme_cfg = sup->cfg.dme_cfg;
+        ret_size = 0;
+        if (d->frame == NULL || d->res == NULL ||
+            d->dev->ops->start_dme(d->dev, sup->nef, sup->nef_size, &ret_size) != 0 ||
+            d->dev->ops->dme_configure(d->dev, &dme_cfg, &d->model_id) != 0) {
+            printf("[%s] could not start DME, not used\n", d->dev->name);
+            d->state = SUP_DEV_DOWN;
+            continue;
+        }
+        d->state = SUP_DEV_UP;
+        sup->m.devices_up++;
+    }
+
+    if (sup->m.devices_up == 0) {
+        kl520_sup_destroy(sup);
+        return NULL;
+    }
+
+    for (i = 0; i < count; i++)
+        pthread_create(&sup->devs[i].thread, NULL, worker_thread, &sup->devs[i]);
+    pthread_create(&sup->watchdog, NULL, watchdog_thread, sup);
+    sup->started = 1;
+    return sup;
+
+err_devs:
+    for (i = 0; i < count; i++)
+        kl520_dev_destroy(devs[i]);
+    return NULL;
+}
+
+void kl520_sup_destroy(struct kl520_sup_s *sup)
+{
+    int i;
+
+    if (sup == NULL)
+        return;
+
+    pthread_mutex_lock(&sup->lock);
+    sup->stop = 1;
+    pthread_cond_broadcast(&sup->work);
+    pthread_mutex_unlock(&sup->lock);
+
+    if (sup->started) {
+        pthread_join(sup->watchdog, NULL);
+        for (i = 0; i < sup->dev_count; i++)
+            pthread_join(sup->devs[i].thread, NULL);
+    }
+
+    pthread_mutex_lock(&sup->lock);
+    fail_queue(sup, KL520_SUP_NO_DEVICE);
+    pthread_mutex_unlock(&sup->lock);
+
+    for (i = 0; i < sup->dev_count; i++) {
+        struct sup_dev_s *d = &sup->devs[i];
+
+        if (d->state == SUP_DEV_UP)
+            d->dev->ops->end_dme(d->dev);
+        kl520_dev_destroy(d->dev);
+        free(d->frame);
+        free(d->res);
+    }
+
+    pthread_cond_destroy(&sup->work);
+    pthread_cond_destroy(&sup->done);
+    pthread_mutex_destroy(&sup->lock);
+    free(sup->nef);
+    free(sup);
+}
+
+int kl520_sup_submit(struct kl520_sup_s *sup, struct kl520_sup_req_s *req)
+{
+    uint32_t deadline_ms = req->deadline_ms ? req->deadline_ms : sup->cfg.deadline_ms;
+
+    req->status = KL520_SUP_PENDING;
+    req->res_len = 0;
+    req->attempts = 0;
+    req->dev_no = -1;
+    req->next = NULL;
+    req->t_submit_ns = kl520_mono_ns();
+    req->t_done_ns = 0;
+    req->deadline_ns = deadline_ms ? req->t_submit_ns + (uint64_t)deadline_ms * 1000000 : 0;
+
+    pthread_mutex_lock(&sup->lock);
+    if (req->img_buf == NULL || req->res == NULL || req->buf_len != sup->cfg.frame_size) {
+        req->status = KL520_SUP_BAD_REQUEST;
+        sup->m.frames_bad_request++;
+        pthread_mutex_unlock(&sup->lock);
+        return -1;
+    }
+    if (sup->stop || devices_left(sup) == 0) {
+        req->status = KL520_SUP_NO_DEVICE;
+        sup->m.frames_no_device++;
+        pthread_mutex_unlock(&sup->lock);
+        return -1;
+    }
+    queue_push(sup, req, 0);
+    pthread_mutex_unlock(&sup->lock);
+    return 0;
+}
+
+int kl520_sup_wait(struct kl520_sup_s *sup, struct kl520_sup_req_s *req)
+{
+    pthread_mutex_lock(&sup->lock);
+    while (req->status == KL520_SUP_PENDING)
+        pthread_cond_wait(&sup->done, &sup->lock);
+    pthread_mutex_unlock(&sup->lock);
+    return req->status;
+}
+
+int kl520_sup_infer(struct kl520_sup_s *sup, struct kl520_sup_req_s *req)
+{
+    if (kl520_sup_submit(sup, req) != 0)
+        return req->status;
+    return kl520_sup_wait(sup, req);
+}
+
+void kl520_sup_get_metrics(struct kl520_sup_s *sup, struct kl520_sup_metrics_s *m)
+{
+    pthread_mutex_lock(&sup->lock);
+    *m = sup->m;
+    pthread_mutex_unlock(&sup->lock);
+}
+
+void kl520_sup_print_metrics(const struct kl520_sup_metrics_s *m)
+{
+    printf("frames: %llu ok, %llu past deadline, %llu failed, %llu no device, %llu bad request, %llu resubmitted\n"
+           "faults: %llu call errors, %llu call timeouts\n"
+           "recovery: %llu recovered, %llu given up, %llu soft / %llu hard resets, "
+           "%llu reconfigured, %llu NEF re-uploads\n"
+           "recovery time: last %.1f ms, mean %.1f ms, max %.1f ms; %d device(s) up\n",
+           (unsigned long long)m->frames_ok, (unsigned long long)m->frames_deadline,
+           (unsigned long long)m->frames_failed, (unsigned long long)m->frames_no_device,
+           (unsigned long long)m->frames_bad_request, (unsigned long long)m->resubmits,
+           (unsigned long long)m->call_errors, (unsigned long long)m->call_timeouts,
+           (unsigned long long)m->recoveries, (unsigned long long)m->recover_failures,
+           (unsigned long long)m->soft_resets, (unsigned long long)m->hard_resets,
+           (unsigned long long)m->reconfigures, (unsigned long long)m->nef_reuploads,
+           m->recovery_ns_last / 1e6, m->recoveries ? m->recovery_ns_total / 1e6 / m->recoveries : 0,
+           m->recovery_ns_max / 1e6, m->devices_up);
+}
@@ -0,0 +1,119 @@
+/**
+ * @file        kl520_supervisor.h
+ * @brief       Supervised DME devices: deadlines, resubmission and recovery without a restart
+ * @version     0.1
+ * @date        2026-10-19
+ *
+ * Frames go to whichever supervised device is free. A failed or hung call takes its device out
+ * of service and the frame goes back to the front of the queue, so another device (or the same
+ * one once it is back) runs it. The device is then recovered from the cached NEF and
+ * kdp_dme_cfg_s: soft reset + configure first, the NEF is only uploaded again if configure
+ * says the model is gone, and a hard reset (reboot + reconnect) is the last resort. A device that
+ * cannot be hard reset goes out of service as soon as a soft reset fails to bring it back.
+ * A hung call is never cancelled: its frame goes to another device right away, but the device
+ * itself is only reset once host_lib's USB timeout ends the call.
+ */
+
+#ifndef __KL520_SUPERVISOR_H__
+#define __KL520_SUPERVISOR_H__
+
+#include <stdint.h>
+#include "kl520_device.h"
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+#define KL520_SUP_DEV_MAX       8
+
+enum kl520_sup_status_e {
+    KL520_SUP_OK = 0,
+    KL520_SUP_PENDING,
+    KL520_SUP_DEADLINE,             /* not finished before the request deadline */
+    KL520_SUP_FAILED,               /* failed on max_attempts devices / resets */
+    KL520_SUP_NO_DEVICE,            /* every device gave up recovering */
+    KL520_SUP_BAD_REQUEST,          /* frame is not frame_size bytes, or the result does not fit */
+};
+
+struct kl520_sup_cfg_s {
+    const char *nef_path;           /* read once, kept in memory for re-uploads; NULL: a dummy for sim devices */
+    struct kdp_dme_cfg_s dme_cfg;   /* restored after every reset */
+    uint32_t frame_size;            /* size of every frame, the model input; others are BAD_REQUEST */
+    uint32_t call_timeout_ms;       /* inference + retrieve longer than this: the device is hung */
+    uint32_t deadline_ms;           /* default per request deadline, 0: none */
+    int max_attempts;               /* tries per frame, the first one included */
+    int recover_attempts;           /* resets before a device is given up: one soft, then hard ones */
+    uint32_t recover_backoff_ms;    /* wait between failed hard resets, doubled each time */
+};
+
+struct kl520_sup_req_s {
+    /* filled by the caller */
+    const char *img_buf;
+    uint32_t buf_len;
+    char *res;
+    uint32_t res_size;
+    uint32_t deadline_ms;           /* 0: kl520_sup_cfg_s.deadline_ms */
+
+    /* filled by the supervisor, valid once kl520_sup_wait() returns */
+    int status;                     /* enum kl520_sup_status_e */
+    uint32_t res_len;
+    int attempts;
+    int dev_no;                     /* device that produced the result */
+    uint64_t t_submit_ns;
+    uint64_t t_done_ns;
+
+    /* private */
+    uint64_t deadline_ns;
+    struct kl520_sup_req_s *next;
+};
+
+struct kl520_sup_metrics_s {
+    uint64_t frames_ok;
+    uint64_t frames_deadline;
+    uint64_t frames_failed;         /* FAILED: device faults used up max_attempts */
+    uint64_t frames_no_device;
+    uint64_t frames_bad_request;
+    uint64_t call_errors;           /* inference / retrieve returned an error */
+    uint64_t call_timeouts;         /* watchdog found a call running past call_timeout_ms */
+    uint64_t resubmits;             /* frames put back in the queue after a device fault */
+    uint64_t soft_resets;
+    uint64_t hard_resets;
+    uint64_t reconfigures;          /* DME configuration restored from the cache */
+    uint64_t nef_reuploads;         /* ... and of those, the NEF had to go up again */
+    uint64_t recoveries;
+    uint64_t recover_failures;
+    uint64_t recovery_ns_last;      /* fault detected -> device serving again */
+    uint64_t recovery_ns_max;
+    uint64_t recovery_ns_total;
+    int devices_up;
+};
+
+struct kl520_sup_s;
+
+/* 1 s call timeout, no deadline, 3 attempts, 5 resets with the hard ones starting 100 ms apart */
+void kl520_sup_cfg_default(struct kl520_sup_cfg_s *cfg);
+
+/* Takes ownership of devs[], also when it fails; uploads the NEF and configures every device before
+ * returning. NULL if the NEF cannot be read or no device comes up, with devs[] destroyed. */
+struct kl520_sup_s *kl520_sup_create(struct kl520_dev_s **devs, int count, const struct kl520_sup_cfg_s *cfg);
+void kl520_sup_destroy(struct kl520_sup_s *sup);
+
+/* Queue the request. img_buf must stay valid until kl520_sup_wait() returns for it; the result
+ * is copied into res only by the attempt that succeeds. Returns 0, or -1 if it was rejected
+ * right away (status says why). */
+int kl520_sup_submit(struct kl520_sup_s *sup, struct kl520_sup_req_s *req);
+
+/* Block until the request is done; returns its status */
+int kl520_sup_wait(struct kl520_sup_s *sup, struct kl520_sup_req_s *req);
+
+/* submit + wait */
+int kl520_sup_infer(struct kl520_sup_s *sup, struct kl520_sup_req_s *req);
+
+void kl520_sup_get_metrics(struct kl520_sup_s *sup, struct kl520_sup_metrics_s *m);
+void kl520_sup_print_metrics(const struct kl520_sup_metrics_s *m);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,218 @@
+/**
+ * @file        kl520_supervisor_demo.cpp
+ * @brief       Keep frames flowing through kl520_supervisor while devices fail underneath it
+ * @version     0.1
+ * @date        2026-10-19
+ *
+ * e.g. two simulated dongles, one fault every ~200 frames of every kind, 300 ms call timeout:
+ *
+ *   ./kl520_supervisor_demo -S 2 -l 8000 -f 5000 -T 300 -n 2000 -q 4
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kl520_device.h"
+#include "kl520_supervisor.h"
+#include "raw_output.h"
+
+#define DME_MODEL_FILE      (HOST_LIB_DIR "/input_models/KL520/test_model/models_520.nef")
+
+#define MODEL_IMG_W         224
+#define MODEL_IMG_H         224
+#define INFERENCE_IMG_SIZE  (MODEL_IMG_W * MODEL_IMG_H * 2)
+#define DEMO_INFLIGHT_MAX   32
+#define DEMO_RES_SIZE       (64 * 1024)
+
+struct demo_slot_s {
+    struct kl520_sup_req_s req;
+    char frame[INFERENCE_IMG_SIZE];
+    char res[DEMO_RES_SIZE];
+    uint32_t sig;
+};
+
+static int cmp_u64(const void *pa, const void *pb)
+{
+    uint64_t a = *(const uint64_t *)pa, b = *(const uint64_t *)pb;
+    return a < b ? -1 : a > b;
+}
+
+static void fill_frame(char *frame, uint32_t len, uint32_t seed)
+{
+    uint32_t i, x = seed * 2654435761u + 1;
+
+    for (i = 0; i + 4 <= len; i += 4) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        memcpy(frame + i, &x, 4);
+    }
+}
+
+static int check_result(const char *res, uint32_t res_len, uint32_t sig)
+{
+    struct raw_output_node_s node;
+    int c;
+
+    if (raw_output_parse(res, res_len, &node, 1) != 1)
+        return -1;
+    for (c = 0; c < node.channel; c++) {
+        if (node.data[c * 16] != (int8_t)((sig >> (c % 24)) & 0x7f))
+            return -1;
+    }
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    printf("usage: %s [options]\n"
+           "  -u N       use N KL520 over USB\n"
+           "  -N path    NEF for -u (default %s)\n"
+           "  -S N       use N simulated devices (default 1 if no -u)\n"
+           "  -l us      simulated per-frame latency (default 10000)\n"
+           "  -f ppm     simulated fault chance per frame, in 1e-6 (default 0)\n"
+           "  -k mask    fault kinds: 1 error, 2 hang, 4 lost model, 8 disconnect (default 15)\n"
+           "  -H ms      how long a hang lasts (default 2000)\n"
+           "  -T ms      call timeout before a device counts as hung (default 1000)\n"
+           "  -d ms      per-frame deadline (default none)\n"
+           "  -a N       attempts per frame (default 3)\n"
+           "  -n N       frames (default 1000)\n"
+           "  -q N       frames in flight (default 4)\n",
+           prog, DME_MODEL_FILE);
+}
+
+int main(int argc, char *argv[])
+{
+    struct kl520_sim_cfg_s sim;
+    struct kl520_sup_cfg_s cfg;
+    struct kl520_sup_metrics_s m;
+    struct kl520_dev_s *devs[KL520_SUP_DEV_MAX];
+    struct kl520_sup_s *sup;
+    struct demo_slot_s *slots;
+    int usb_idx[KL520_SUP_DEV_MAX];
+    int usb_count = 0, sim_count = 0, frames = 1000, inflight = 4, count, opt, i;
+    int submitted = 0, finished = 0, ok = 0, mismatch = 0, status_count[KL520_SUP_BAD_REQUEST + 1];
+    uint64_t *lat, t0, t_last_done, gap, gap_max = 0;
+
+    kl520_sim_cfg_default(&sim);
+    kl520_sup_cfg_default(&cfg);
+
+    while ((opt = getopt(argc, argv, "u:N:S:l:f:k:H:T:d:a:n:q:h")) != -1) {
+        switch (opt) {
+        case 'u': usb_count = atoi(optarg); break;
+        case 'N': cfg.nef_path = optarg; break;
+        case 'S': sim_count = atoi(optarg); break;
+        case 'l': sim.frame_latency_us = atoi(optarg); break;
+        case 'f': sim.fault_ppm = atoi(optarg); break;
+        case 'k': sim.fault_mask = strtoul(optarg, NULL, 0); break;
+        case 'H': sim.hang_ms = atoi(optarg); break;
+        case 'T': cfg.call_timeout_ms = atoi(optarg); break;
+        case 'd': cfg.deadline_ms = atoi(optarg); break;
+        case 'a': cfg.max_attempts = atoi(optarg); break;
+        case 'n': frames = atoi(optarg); break;
+        case 'q': inflight = atoi(optarg); break;
+        default: usage(argv[0]); return opt == 'h' ? 0 : -1;
+        }
+    }
+
+    if (usb_count == 0 && sim_count == 0)
+        sim_count = 1;
+    count = usb_count ? usb_count : sim_count;
+    if (count > KL520_SUP_DEV_MAX || inflight < 1 || inflight > DEMO_INFLIGHT_MAX || frames < 1) {
+        usage(argv[0]);
+        return -1;
+    }
+    if (usb_count && cfg.nef_path == NULL)
+        cfg.nef_path = DME_MODEL_FILE;
+
+    cfg.frame_size = INFERENCE_IMG_SIZE;
+    cfg.dme_cfg.model_id     = 1;
+    cfg.dme_cfg.output_num   = 1;
+    cfg.dme_cfg.image_col    = MODEL_IMG_W;
+    cfg.dme_cfg.image_row    = MODEL_IMG_H;
+    cfg.dme_cfg.image_ch     = 3;
+    cfg.dme_cfg.image_format = IMAGE_FORMAT_SUB128 | NPU_FORMAT_RGB565 | IMAGE_FORMAT_RAW_OUTPUT;
+
+    if (usb_count && kl520_usb_open(usb_count, usb_idx) != 0)
+        return -1;
+    for (i = 0; i < count; i++) {
+        devs[i] = usb_count ? kl520_usb_device_create(usb_idx[i]) : kl520_sim_device_create(i, &sim);
+        if (devs[i] == NULL)
+            return -1;
+    }
+
+    sup = kl520_sup_create(devs, count, &cfg);
+    if (sup == NULL) {
+        printf("no device came up\n");
+        return -1;
+    }
+
+    slots = (struct demo_slot_s *)calloc(inflight, sizeof(struct demo_slot_s));
+    lat = (uint64_t *)calloc(frames, sizeof(uint64_t));
+    if (slots == NULL || lat == NULL) {
+        printf("out of memory for %d frames\n", frames);
+        kl520_sup_destroy(sup);
+        if (usb_count)
+            kl520_usb_close();
+        free(slots);
+        free(lat);
+        return -1;
+    }
+    memset(status_count, 0, sizeof(status_count));
+
+    /* keep inflight frames queued, collect them in submission order */
+    t0 = t_last_done = kl520_mono_ns();
+    while (finished < frames) {
+        while (submitted < frames && submitted - finished < inflight) {
+            struct demo_slot_s *s = &slots[submitted % inflight];
+
+            fill_frame(s->frame, INFERENCE_IMG_SIZE, submitted);
+            s->sig = kl520_sim_frame_signature(s->frame, INFERENCE_IMG_SIZE);
+            memset(&s->req, 0, sizeof(s->req));
+            s->req.img_buf = s->frame;
+            s->req.buf_len = INFERENCE_IMG_SIZE;
+            s->req.res = s->res;
+            s->req.res_size = DEMO_RES_SIZE;
+            kl520_sup_submit(sup, &s->req);
+            submitted++;
+        }
+
+        {
+            struct demo_slot_s *s = &slots[finished % inflight];
+            int status = kl520_sup_wait(sup, &s->req);
+
+            status_count[status]++;
+            if (status == KL520_SUP_OK) {
+                lat[ok++] = s->req.t_done_ns - s->req.t_submit_ns;
+                if (usb_count == 0 && check_result(s->res, s->req.res_len, s->sig) != 0)
+                    mismatch++;
+                gap = s->req.t_done_ns > t_last_done ? s->req.t_done_ns - t_last_done : 0;
+                if (gap > gap_max)
+                    gap_max = gap;
+                if (s->req.t_done_ns > t_last_done)
+                    t_last_done = s->req.t_done_ns;
+            }
+            finished++;
+        }
+    }
+
+    qsort(lat, ok, sizeof(uint64_t), cmp_u64);
+    printf("%d frames in %.2f s: %d ok, %d past deadline, %d failed, %d no device, %d bad request, %d mismatched\n",
+           frames, (kl520_mono_ns() - t0) / 1e9, ok, status_count[KL520_SUP_DEADLINE], status_count[KL520_SUP_FAILED],
+           status_count[KL520_SUP_NO_DEVICE], status_count[KL520_SUP_BAD_REQUEST], mismatch);
+    if (ok)
+        printf("latency p50 %.2f ms, p99 %.2f ms, max %.2f ms; longest stretch without a result %.1f ms\n",
+               lat[(ok - 1) / 2] / 1e6, lat[(int)((ok - 1) * 0.99)] / 1e6, lat[ok - 1] / 1e6, gap_max / 1e6);
+
+    kl520_sup_get_metrics(sup, &m);
+    kl520_sup_print_metrics(&m);
+
+    kl520_sup_destroy(sup);
+    if (usb_count)
+        kl520_usb_close();
+    free(slots);
+    free(lat);
+    return (mismatch || ok + status_count[KL520_SUP_DEADLINE] != frames) ? -1 : 0;
+}
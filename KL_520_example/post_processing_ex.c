@@ -16,6 +16,7 @@
 #include "base.h"// header file in /common/include
 #include "kdpio.h"
 #include "user_util.h"
+#include "raw_output.h"
 
 #define YOLO_V3_O1_GRID_W       7
 #define YOLO_V3_O1_GRID_H       7
@@ -462,87 +463,44 @@ float get_float(int h, int w, int c, int image_p_h, int image_p_w, int image_p_c
     return res_float_array[h*image_p_c*image_p_w + c*image_p_w + w];
 }
 
-int post_processing_simplest(int model_id, struct kdp_image_s *image_p, float *res_float_array, int res_float_array_max, int *res_float_len)
+static void post_out_node_to_raw(struct kdp_image_s *image_p, int idx, struct raw_output_node_s *node)
 {
-    struct imagenet_post_globals_s *gp = &u_globals.imgnet;
-    uint8_t *result_p;
-    int w, c, h, len, data_size, div, image_p_w, image_p_c, image_p_h;
-    float scale;
+    node->data = (const int8_t *)POSTPROC_OUT_NODE_ADDR(image_p, idx);
+    node->width = POSTPROC_OUT_NODE_COL(image_p, idx);
+    node->channel = POSTPROC_OUT_NODE_CH(image_p, idx);
+    node->height = POSTPROC_OUT_NODE_ROW(image_p, idx);
+    node->radix = POSTPROC_OUT_NODE_RADIX(image_p, idx);
+    node->scale = POSTPROC_OUT_NODE_SCALE(image_p, idx);
+    node->data_size = (POSTPROC_OUTPUT_FORMAT(image_p) & BIT(0)) + 1;     /* 1 or 2 in bytes */
+}
 
-    data_size = (POSTPROC_OUTPUT_FORMAT(image_p) & BIT(0)) + 1;     /* 1 or 2 in bytes */
+int post_processing_simplest(int model_id, struct kdp_image_s *image_p, float *res_float_array, int res_float_array_max, int *res_float_len)
+{
+    struct raw_output_node_s node;
 
-    int8_t *src_p = (int8_t *)POSTPROC_OUT_NODE_ADDR(image_p, 0);
-    image_p_w = POSTPROC_OUT_NODE_COL(image_p, 0);
-    image_p_c = POSTPROC_OUT_NODE_CH(image_p, 0);
-    image_p_h = POSTPROC_OUT_NODE_ROW(image_p, 0);
+    post_out_node_to_raw(image_p, 0, &node);
 
-    if (image_p_w * image_p_c * image_p_h >= res_float_array_max)
+    *res_float_len = 0;
+    if (raw_output_node_len(&node) >= res_float_array_max)
     {
         printf("nerual output size greater than res_float_array_max\n");
         return 0;
     }
 
-    scale = POSTPROC_OUT_NODE_SCALE(image_p, 0);
-    div = 1 << POSTPROC_OUT_NODE_RADIX(image_p, 0);
-    printf("(w, c, h) = %d, %d, %d\n", image_p_w, image_p_c, image_p_h);
-
-    int image_p_w_aligned = round_up(image_p_w);
+    printf("(w, c, h) = %d, %d, %d\n", node.width, node.channel, node.height);
 
-    *res_float_len = 0;
-    for(h=0; h<image_p_h; ++h){
-        for(c=0; c<image_p_c; ++c){
-            for(w=0; w<image_p_w; ++w){
-                int ind = h*image_p_c*image_p_w + c*image_p_w + w;
-                res_float_array[ind] = (float)*src_p;
-                res_float_array[ind] = do_div_scale(res_float_array[ind], div, scale);
-                *res_float_len += 1;
-                src_p += data_size;
-            }
-            src_p += data_size*(image_p_w_aligned-image_p_w);
-        }
-    }
+    raw_output_dequant(&node, res_float_array);
+    *res_float_len = raw_output_node_len(&node);
     return 0;
 }
 
 int post_processing_sigmoid(int model_id, struct kdp_image_s *image_p, float *res_float_array, int res_float_array_max, int *res_float_len)
 {
-    struct imagenet_post_globals_s *gp = &u_globals.imgnet;
-    uint8_t *result_p;
-    int w, c, h, len, data_size, div, image_p_w, image_p_c, image_p_h;
-    float scale;
-
-    data_size = (POSTPROC_OUTPUT_FORMAT(image_p) & BIT(0)) + 1;     /* 1 or 2 in bytes */
-
-    int8_t *src_p = (int8_t *)POSTPROC_OUT_NODE_ADDR(image_p, 0);
-    image_p_w = POSTPROC_OUT_NODE_COL(image_p, 0);
-    image_p_c = POSTPROC_OUT_NODE_CH(image_p, 0);
-    image_p_h = POSTPROC_OUT_NODE_ROW(image_p, 0);
-
-    if (image_p_w * image_p_c * image_p_h >= res_float_array_max)
-    {
-        printf("nerual output size greater than res_float_array_max\n");
-        return 0;
-    }
-
-    scale = POSTPROC_OUT_NODE_SCALE(image_p, 0);
-    div = 1 << POSTPROC_OUT_NODE_RADIX(image_p, 0);
-    printf("(w, c, h) = %d, %d, %d\n", image_p_w, image_p_c, image_p_h);
+    int i;
 
-    int image_p_w_aligned = round_up(image_p_w);
+    post_processing_simplest(model_id, image_p, res_float_array, res_float_array_max, res_float_len);
 
-    *res_float_len = 0;
-    for(h=0; h<image_p_h; ++h){
-        for(c=0; c<image_p_c; ++c){
-            for(w=0; w<image_p_w; ++w){
-                int ind = h*image_p_c*image_p_w + c*image_p_w + w;
-                res_float_array[ind] = (float)*src_p;
-                res_float_array[ind] = do_div_scale(res_float_array[ind], div, scale);
-                res_float_array[ind] = sigmoid(res_float_array[ind]);
-                *res_float_len += 1;
-                src_p += data_size;
-            }
-            src_p += data_size*(image_p_w_aligned-image_p_w);
-        }
-    }
+    for (i = 0; i < *res_float_len; ++i)
+        res_float_array[i] = sigmoid(res_float_array[i]);
     return 0;
 }
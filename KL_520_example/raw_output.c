@@ -0,0 +1,92 @@
+/**
+ * @file        raw_output.c
+ * @brief       Parse and dequantize the raw DME result buffer (IMAGE_FORMAT_RAW_OUTPUT)
+ * @version     0.1
+ * @date        2026-10-19
+ */
+
+#include <stddef.h>
+#include "raw_output.h"
+
+#define RAW_OUTPUT_COL_MIN      16 /* Bytes, same as KDP_COL_MIN in post_processing_ex.c */
+
+/* Same layout as struct output_node_params in the host lib */
+struct raw_node_params_s {
+    int height;
+    int channel;
+    int width;
+    int radix;
+    float scale;
+};
+
+static int raw_output_round_up(int num)
+{
+    return ((num + (RAW_OUTPUT_COL_MIN - 1)) & ~(RAW_OUTPUT_COL_MIN - 1));
+}
+
+int raw_output_parse(const char *inf_res, uint32_t inf_size, struct raw_output_node_s *nodes, int max_nodes)
+{
+    const struct raw_node_params_s *p_node_info;
+    int output_num, i;
+    uint32_t offset;
+
+    if (inf_size < sizeof(int))
+        return -1;
+
+    output_num = inf_res[0];
+    if (output_num <= 0 || output_num > max_nodes)
+        return -1;
+
+    offset = sizeof(int) + output_num * sizeof(struct raw_node_params_s);
+    if (offset > inf_size)
+        return -1;
+
+    for (i = 0; i < output_num; i++) {
+        p_node_info = (const struct raw_node_params_s *)(inf_res + sizeof(int) + i * sizeof(struct raw_node_params_s));
+
+        nodes[i].height = p_node_info->height;
+        nodes[i].channel = p_node_info->channel;
+        nodes[i].width = p_node_info->width;
+        nodes[i].radix = p_node_info->radix;
+        nodes[i].scale = p_node_info->scale;
+        nodes[i].data_size = 1;
+        nodes[i].data = (const int8_t *)(inf_res + offset);
+
+        offset += p_node_info->channel * p_node_info->height * raw_output_round_up(p_node_info->width) * nodes[i].data_size;
+        if (offset > inf_size)
+            return -1;
+    }
+
+    return output_num;
+}
+
+int raw_output_node_len(const struct raw_output_node_s *node)
+{
+    return node->height * node->channel * node->width;
+}
+
+void raw_output_dequant(const struct raw_output_node_s *node, float *dst)
+{
+    const int8_t *src_p = node->data;
+    int row_bytes = raw_output_round_up(node->width) * node->data_size;
+    int rows = node->height * node->channel;
+    int width = node->width;
+    int r, w;
+
+    /* one multiply per element instead of two divides, as post_yolo_v3() does */
+    float f_scale = 1.0f / ((float)(1 << node->radix) * node->scale);
+
+    for (r = 0; r < rows; r++) {
+        if (node->data_size == 2) {
+            const int16_t *src16_p = (const int16_t *)src_p;
+
+            for (w = 0; w < width; w++)
+                dst[w] = (float)src16_p[w] * f_scale;
+        } else {
+            for (w = 0; w < width; w++)
+                dst[w] = (float)src_p[w] * f_scale;
+        }
+        dst += width;
+        src_p += row_bytes;
+    }
+}
@@ -0,0 +1,49 @@
+/**
+ * @file        raw_output.h
+ * @brief       Parse and dequantize the raw DME result buffer (IMAGE_FORMAT_RAW_OUTPUT)
+ * @version     0.1
+ * @date        2026-10-19
+ */
+
+#ifndef __RAW_OUTPUT_H__
+#define __RAW_OUTPUT_H__
+
+#include <stdint.h>
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+#define RAW_OUTPUT_NODE_MAX     50
+
+/* One output node of the buffer returned by kdp_dme_retrieve_res().
+ * The buffer is laid out as
+ *   TOTAL_OUT_NUMBER + (H/C/W/RADIX/SCALE) + (H/C/W/RADIX/SCALE) + ... + FP_DATA + FP_DATA + ...
+ * where every (H/C/W/RADIX/SCALE) block is a struct output_node_params, and every
+ * FP_DATA block is H x C x round_up(W) values of data_size bytes. */
+struct raw_output_node_s {
+    int height;
+    int channel;
+    int width;
+    int radix;
+    float scale;
+    int data_size;                  /* bytes per value: 1 (int8) or 2 (int16) */
+    const int8_t *data;
+};
+
+/* Fill nodes[] from a retrieved result buffer. The buffer does not say how wide its values are;
+ * the host lib only retrieves 8-bit output (POSTPROC_OUTPUT_FORMAT bit 0 clear), so data_size is 1.
+ * Returns the number of output nodes, or -1 if the buffer is shorter than its header says. */
+int raw_output_parse(const char *inf_res, uint32_t inf_size, struct raw_output_node_s *nodes, int max_nodes);
+
+/* Number of floats raw_output_dequant() writes for the node (H x C x W). */
+int raw_output_node_len(const struct raw_output_node_s *node);
+
+/* Convert the node to float in (h, c, w) order: dst[h*C*W + c*W + w] = q / (2^radix * scale). */
+void raw_output_dequant(const struct raw_output_node_s *node, float *dst);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif
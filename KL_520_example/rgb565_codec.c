@@ -0,0 +1,203 @@
+/**
+ * @file        rgb565_codec.c
+ * @brief       RGB888 <-> RGB565 pixel conversion (SSSE3 / NEON / scalar)
+ * @version     0.1
+ * @date        2026-10-19
+ */
+
+#include "rgb565_codec.h"
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define RGB565_USE_SSSE3
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RGB565_USE_NEON
+#endif
+
+static void rgb888_to_rgb565_scalar(const uint8_t *src, uint16_t *dst, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        dst[i] = (uint16_t)(((src[0] >> 3) << 11) | ((src[1] >> 2) << 5) | (src[2] >> 3));
+        src += 3;
+    }
+}
+
+static void rgb565_to_rgb888_scalar(const uint16_t *src, uint8_t *dst, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        dst[0] = (uint8_t)((src[i] >> 11) << 3);
+        dst[1] = (uint8_t)(((src[i] >> 5) & 0x3f) << 2);
+        dst[2] = (uint8_t)((src[i] & 0x1f) << 3);
+        dst += 3;
+    }
+}
+
+#if defined(RGB565_USE_SSSE3)
+
+/* 16 pixels per iteration: three 16-byte loads are split into R, G and B planes
+ * with pshufb, packed as 2 x 8 words, and the reverse for unpacking. */
+
+void rgb888_to_rgb565(const uint8_t *src, uint16_t *dst, size_t n)
+{
+    const __m128i r_a = _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i r_b = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1);
+    const __m128i r_c = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13);
+    const __m128i g_a = _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i g_b = _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1);
+    const __m128i g_c = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14);
+    const __m128i b_a = _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i b_b = _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1);
+    const __m128i b_c = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mask_r = _mm_set1_epi16(0xf8);
+    const __m128i mask_g = _mm_set1_epi16(0xfc);
+    size_t i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+
+        __m128i r = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, r_a), _mm_shuffle_epi8(b, r_b)), _mm_shuffle_epi8(c, r_c));
+        __m128i g = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, g_a), _mm_shuffle_epi8(b, g_b)), _mm_shuffle_epi8(c, g_c));
+        __m128i bl = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, b_a), _mm_shuffle_epi8(b, b_b)), _mm_shuffle_epi8(c, b_c));
+
+        __m128i lo = _mm_or_si128(_mm_or_si128(
+                         _mm_slli_epi16(_mm_and_si128(_mm_unpacklo_epi8(r, zero), mask_r), 8),
+                         _mm_slli_epi16(_mm_and_si128(_mm_unpacklo_epi8(g, zero), mask_g), 3)),
+                         _mm_srli_epi16(_mm_unpacklo_epi8(bl, zero), 3));
+        __m128i hi = _mm_or_si128(_mm_or_si128(
+                         _mm_slli_epi16(_mm_and_si128(_mm_unpackhi_epi8(r, zero), mask_r), 8),
+                         _mm_slli_epi16(_mm_and_si128(_mm_unpackhi_epi8(g, zero), mask_g), 3)),
+                         _mm_srli_epi16(_mm_unpackhi_epi8(bl, zero), 3));
+
+        _mm_storeu_si128((__m128i *)(dst + i), lo);
+        _mm_storeu_si128((__m128i *)(dst + i + 8), hi);
+        src += 48;
+    }
+
+    rgb888_to_rgb565_scalar(src, dst + i, n - i);
+}
+
+void rgb565_to_rgb888(const uint16_t *src, uint8_t *dst, size_t n)
+{
+    const __m128i o0_r = _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5);
+    const __m128i o0_g = _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1);
+    const __m128i o0_b = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+    const __m128i o1_r = _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1);
+    const __m128i o1_g = _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10);
+    const __m128i o1_b = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1);
+    const __m128i o2_r = _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1);
+    const __m128i o2_g = _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1);
+    const __m128i o2_b = _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15);
+    const __m128i mask_r = _mm_set1_epi16(0xf8);
+    const __m128i mask_g = _mm_set1_epi16(0xfc);
+    size_t i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        __m128i v0 = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i v1 = _mm_loadu_si128((const __m128i *)(src + i + 8));
+
+        __m128i r = _mm_packus_epi16(_mm_and_si128(_mm_srli_epi16(v0, 8), mask_r),
+                                     _mm_and_si128(_mm_srli_epi16(v1, 8), mask_r));
+        __m128i g = _mm_packus_epi16(_mm_and_si128(_mm_srli_epi16(v0, 3), mask_g),
+                                     _mm_and_si128(_mm_srli_epi16(v1, 3), mask_g));
+        __m128i b = _mm_packus_epi16(_mm_and_si128(_mm_slli_epi16(v0, 3), mask_r),
+                                     _mm_and_si128(_mm_slli_epi16(v1, 3), mask_r));
+
+        _mm_storeu_si128((__m128i *)(dst), _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(r, o0_r), _mm_shuffle_epi8(g, o0_g)), _mm_shuffle_epi8(b, o0_b)));
+        _mm_storeu_si128((__m128i *)(dst + 16), _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(r, o1_r), _mm_shuffle_epi8(g, o1_g)), _mm_shuffle_epi8(b, o1_b)));
+        _mm_storeu_si128((__m128i *)(dst + 32), _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(r, o2_r), _mm_shuffle_epi8(g, o2_g)), _mm_shuffle_epi8(b, o2_b)));
+        dst += 48;
+    }
+
+    rgb565_to_rgb888_scalar(src + i, dst, n - i);
+}
+
+const char *rgb565_codec_isa(void)
+{
+    return "ssse3";
+}
+
+#elif defined(RGB565_USE_NEON)
+
+void rgb888_to_rgb565(const uint8_t *src, uint16_t *dst, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        uint8x16x3_t px = vld3q_u8(src);
+        uint8x16_t r = vshrq_n_u8(px.val[0], 3);
+        uint8x16_t g = vshrq_n_u8(px.val[1], 2);
+        uint8x16_t b = vshrq_n_u8(px.val[2], 3);
+
+        uint16x8_t lo = vorrq_u16(vorrq_u16(vshlq_n_u16(vmovl_u8(vget_low_u8(r)), 11),
+                                            vshlq_n_u16(vmovl_u8(vget_low_u8(g)), 5)),
+                                  vmovl_u8(vget_low_u8(b)));
+        uint16x8_t hi = vorrq_u16(vorrq_u16(vshlq_n_u16(vmovl_u8(vget_high_u8(r)), 11),
+                                            vshlq_n_u16(vmovl_u8(vget_high_u8(g)), 5)),
+                                  vmovl_u8(vget_high_u8(b)));
+
+        vst1q_u16(dst + i, lo);
+        vst1q_u16(dst + i + 8, hi);
+        src += 48;
+    }
+
+    rgb888_to_rgb565_scalar(src, dst + i, n - i);
+}
+
+void rgb565_to_rgb888(const uint16_t *src, uint8_t *dst, size_t n)
+{
+    const uint16x8_t mask_g = vdupq_n_u16(0x3f);
+    const uint16x8_t mask_b = vdupq_n_u16(0x1f);
+    size_t i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        uint16x8_t v0 = vld1q_u16(src + i);
+        uint16x8_t v1 = vld1q_u16(src + i + 8);
+        uint8x16x3_t px;
+
+        px.val[0] = vshlq_n_u8(vcombine_u8(vmovn_u16(vshrq_n_u16(v0, 11)),
+                                           vmovn_u16(vshrq_n_u16(v1, 11))), 3);
+        px.val[1] = vshlq_n_u8(vcombine_u8(vmovn_u16(vandq_u16(vshrq_n_u16(v0, 5), mask_g)),
+                                           vmovn_u16(vandq_u16(vshrq_n_u16(v1, 5), mask_g))), 2);
+        px.val[2] = vshlq_n_u8(vcombine_u8(vmovn_u16(vandq_u16(v0, mask_b)),
+                                           vmovn_u16(vandq_u16(v1, mask_b))), 3);
+        vst3q_u8(dst, px);
+        dst += 48;
+    }
+
+    rgb565_to_rgb888_scalar(src + i, dst, n - i);
+}
+
+const char *rgb565_codec_isa(void)
+{
+    return "neon";
+}
+
+#else
+
+void rgb888_to_rgb565(const uint8_t *src, uint16_t *dst, size_t n)
+{
+    rgb888_to_rgb565_scalar(src, dst, n);
+}
+
+void rgb565_to_rgb888(const uint16_t *src, uint8_t *dst, size_t n)
+{
+    rgb565_to_rgb888_scalar(src, dst, n);
+}
+
+const char *rgb565_codec_isa(void)
+{
+    return "scalar";
+}
+
+#endif
@@ -0,0 +1,35 @@
+/**
+ * @file        rgb565_codec.h
+ * @brief       RGB888 <-> RGB565 pixel conversion (SSSE3 / NEON / scalar)
+ * @version     0.1
+ * @date        2026-10-19
+ */
+
+#ifndef __RGB565_CODEC_H__
+#define __RGB565_CODEC_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+/* Pack n interleaved R,G,B bytes into n RGB565 words (src[0] in bits 15..11).
+ * cv::cvtColor(..., CV_BGR2BGR565) also puts R in the high bits, so an OpenCV BGR frame has to be
+ * swapped to R,G,B order first to get the same words; passing B,G,R as is puts B on top. */
+void rgb888_to_rgb565(const uint8_t *src, uint16_t *dst, size_t n);
+
+/* Unpack n RGB565 words into interleaved R,G,B bytes.
+ * Each channel is shifted back up without bit replication (r5 * 8, g6 * 4, b5 * 8),
+ * which is what Python_validation/Main.ipynb feeds the keras reference model. */
+void rgb565_to_rgb888(const uint16_t *src, uint8_t *dst, size_t n);
+
+/* Name of the kernel compiled in: "ssse3", "neon" or "scalar". */
+const char *rgb565_codec_isa(void);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,113 @@
+"""Export the Dense heads of several keras models that share one backbone into a KLHD heads file.
+
+    python export_heads.py --out heads.bin model01.h5 model02.h5 model03.h5 \
+        --backbone-out backbone.h5
+
+Every model is expected to be <backbone up to GlobalAveragePooling2D> -> Dense (-> Activation), as
+built in Main.ipynb. Only the backbone (saved with --backbone-out) is compiled into the .nef; the
+heads are evaluated on the host by KL_520_example/dense_heads.c. The file layout is documented in
+KL_520_example/dense_heads.h.
+"""
+
+import argparse
+import hashlib
+import os
+import struct
+
+import numpy as np
+
+HEADS_MAGIC = b'KLHD'
+HEADS_VERSION = 1
+NAME_LEN = 32
+ACTIVATIONS = {'linear': 0, 'softmax': 1, 'sigmoid': 2}
+
+
+def find_head(model):
+    """Last Dense layer of the model and the activation applied to its output."""
+    from keras.layers import Activation, Dense
+
+    dense = [layer for layer in model.layers if isinstance(layer, Dense)]
+    if not dense:
+        raise ValueError('%s has no Dense layer' % model.name)
+    head = dense[-1]
+    activation = head.get_config()['activation']
+    tail = model.layers[model.layers.index(head) + 1:]
+    if activation == 'linear' and tail and isinstance(tail[0], Activation):
+        activation = tail[0].get_config()['activation']
+    if activation not in ACTIVATIONS:
+        raise ValueError('%s: activation %s is not supported on the host' % (head.name, activation))
+    return head, activation
+
+
+def backbone_of(model):
+    from keras.layers import GlobalAveragePooling2D
+    from keras.models import Model
+
+    for layer in model.layers:
+        if isinstance(layer, GlobalAveragePooling2D):
+            return Model(inputs=model.input, outputs=layer.output)
+    raise ValueError('%s has no GlobalAveragePooling2D layer' % model.name)
+
+
+def backbone_digest(backbone):
+    """Hash of the backbone weights, equal only for models whose heads can share one .nef."""
+    digest = hashlib.sha256()
+    for w in backbone.get_weights():
+        digest.update(str(w.shape).encode())
+        digest.update(np.ascontiguousarray(w, dtype='<f4').tobytes())
+    return digest.hexdigest()
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('models', nargs='+', help='keras .h5 models sharing the same backbone')
+    parser.add_argument('--out', default='heads.bin')
+    parser.add_argument('--names', default=None, help='comma separated head names (default: file names)')
+    parser.add_argument('--backbone-out', default=None, help='also save the shared backbone as .h5')
+    args = parser.parse_args()
+
+    from keras.models import load_model
+
+    names = args.names.split(',') if args.names else \
+        [os.path.splitext(os.path.basename(p))[0] for p in args.models]
+    if len(names) != len(args.models):
+        parser.error('--names needs one name per model')
+
+    heads = []
+    in_dim = None
+    backbone = None
+    digest = None
+    for path, name in zip(args.models, names):
+        model = load_model(path)
+        head, activation = find_head(model)
+        model_backbone = backbone_of(model)
+        model_digest = backbone_digest(model_backbone)
+        if digest is None:
+            backbone, digest = model_backbone, model_digest
+        elif model_digest != digest:
+            raise ValueError('%s: backbone weights differ from %s, its head needs its own .nef'
+                             % (path, args.models[0]))
+        kernel, bias = [w.astype('<f4') for w in head.get_weights()]
+        if in_dim is not None and kernel.shape[0] != in_dim:
+            raise ValueError('%s: input dim %d, expected %d' % (path, kernel.shape[0], in_dim))
+        in_dim = kernel.shape[0]
+        heads.append((name, activation, kernel, bias))
+        print('%-20s %d -> %d, %s' % (name, kernel.shape[0], kernel.shape[1], activation))
+    print('backbone sha256 %s' % digest)
+
+    if args.backbone_out:
+        backbone.save(args.backbone_out)
+        print('backbone saved to %s' % args.backbone_out)
+
+    with open(args.out, 'wb') as f:
+        f.write(HEADS_MAGIC + struct.pack('<III', HEADS_VERSION, len(heads), in_dim))
+        for name, activation, kernel, bias in heads:
+            f.write(struct.pack('<II', kernel.shape[1], ACTIVATIONS[activation]))
+            f.write(name.encode()[:NAME_LEN - 1].ljust(NAME_LEN, b'\0'))
+            f.write(np.ascontiguousarray(kernel).tobytes())
+            f.write(bias.tobytes())
+    print('%d heads written to %s' % (len(heads), args.out))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,625 @@
+/**
+ * @file        kl520py.c
+ * @brief       Python bindings for the KL520 host pipeline
+ *              (RGB565 codec, kneron preprocessing, raw output dequantization, DME batch inference)
+ * @version     0.1
+ * @date        2026-10-19
+ *
+ * Results that come out of host buffers (dequantize / infer_batch) are returned as NumPy arrays
+ * that view a single malloc()'ed block; the block is freed when the last array referencing it dies.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <numpy/arrayobject.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rgb565_codec.h"
+#include "raw_output.h"
+
+#ifdef KL520PY_WITH_HOST_LIB
+#include <stdbool.h>
+#include "kdp_host.h"
+#endif
+
+#define HOST_BUFFER_NAME        "kl520py.host_buffer"
+#define PREPROC_BLOCK_PIXELS    4096
+
+static void host_buffer_free(PyObject *capsule)
+{
+    free(PyCapsule_GetPointer(capsule, HOST_BUFFER_NAME));
+}
+
+/* Takes ownership of buf: it is freed with the capsule, or right away on failure */
+static PyObject *host_buffer_new(void *buf)
+{
+    PyObject *capsule = PyCapsule_New(buf, HOST_BUFFER_NAME, host_buffer_free);
+
+    if (capsule == NULL)
+        free(buf);
+    return capsule;
+}
+
+/* ndarray over data (which lives inside owner's host buffer), keeping owner alive */
+static PyObject *host_buffer_array(PyObject *owner, int nd, npy_intp *dims, int typenum, void *data)
+{
+    PyObject *arr = PyArray_SimpleNewFromData(nd, dims, typenum, data);
+
+    if (arr == NULL)
+        return NULL;
+
+    Py_INCREF(owner);
+    if (PyArray_SetBaseObject((PyArrayObject *)arr, owner) < 0) {
+        Py_DECREF(arr);
+        return NULL;
+    }
+    return arr;
+}
+
+static PyArrayObject *as_pixel_array(PyObject *obj, int typenum, int min_dims)
+{
+    return (PyArrayObject *)PyArray_FROMANY(obj, typenum, min_dims, NPY_MAXDIMS,
+                                            NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED);
+}
+
+static int check_rgb_shape(PyArrayObject *arr)
+{
+    if (PyArray_DIM(arr, PyArray_NDIM(arr) - 1) != 3) {
+        PyErr_SetString(PyExc_ValueError, "last dimension must be 3 (R, G, B)");
+        return -1;
+    }
+    return 0;
+}
+
+static PyObject *py_rgb888_to_rgb565(PyObject *self, PyObject *args)
+{
+    PyObject *obj;
+    PyArrayObject *src, *dst;
+    npy_intp n;
+
+    if (!PyArg_ParseTuple(args, "O", &obj))
+        return NULL;
+
+    src = as_pixel_array(obj, NPY_UINT8, 2);
+    if (src == NULL)
+        return NULL;
+    if (check_rgb_shape(src) < 0) {
+        Py_DECREF(src);
+        return NULL;
+    }
+
+    dst = (PyArrayObject *)PyArray_SimpleNew(PyArray_NDIM(src) - 1, PyArray_DIMS(src), NPY_UINT16);
+    if (dst == NULL) {
+        Py_DECREF(src);
+        return NULL;
+    }
+
+    n = PyArray_SIZE(dst);
+    Py_BEGIN_ALLOW_THREADS
+    rgb888_to_rgb565((const uint8_t *)PyArray_DATA(src), (uint16_t *)PyArray_DATA(dst), n);
+    Py_END_ALLOW_THREADS
+
+    Py_DECREF(src);
+    return (PyObject *)dst;
+}
+
+static PyObject *py_rgb565_to_rgb888(PyObject *self, PyObject *args)
+{
+    PyObject *obj;
+    PyArrayObject *src, *dst;
+    npy_intp dims[NPY_MAXDIMS];
+    int nd;
+    npy_intp n;
+
+    if (!PyArg_ParseTuple(args, "O", &obj))
+        return NULL;
+
+    src = as_pixel_array(obj, NPY_UINT16, 1);
+    if (src == NULL)
+        return NULL;
+
+    nd = PyArray_NDIM(src);
+    if (nd == NPY_MAXDIMS) {
+        PyErr_SetString(PyExc_ValueError, "too many dimensions");
+        Py_DECREF(src);
+        return NULL;
+    }
+    memcpy(dims, PyArray_DIMS(src), nd * sizeof(npy_intp));
+    dims[nd] = 3;
+
+    dst = (PyArrayObject *)PyArray_SimpleNew(nd + 1, dims, NPY_UINT8);
+    if (dst == NULL) {
+        Py_DECREF(src);
+        return NULL;
+    }
+
+    n = PyArray_SIZE(src);
+    Py_BEGIN_ALLOW_THREADS
+    rgb565_to_rgb888((const uint16_t *)PyArray_DATA(src), (uint8_t *)PyArray_DATA(dst), n);
+    Py_END_ALLOW_THREADS
+
+    Py_DECREF(src);
+    return (PyObject *)dst;
+}
+
+/* RGB888 -> RGB565 -> RGB888 -> x / 256 - 0.5, i.e. what the NPU sees with
+ * "img_preprocess_method": "kneron" and NPU_FORMAT_RGB565 */
+static void kneron_preprocess(const uint8_t *src, float *dst, size_t n)
+{
+    uint16_t rgb565[PREPROC_BLOCK_PIXELS];
+    uint8_t rgb888[PREPROC_BLOCK_PIXELS * 3];
+    size_t i, k, len;
+
+    for (i = 0; i < n; i += len) {
+        len = n - i < PREPROC_BLOCK_PIXELS ? n - i : PREPROC_BLOCK_PIXELS;
+        rgb888_to_rgb565(src + i * 3, rgb565, len);
+        rgb565_to_rgb888(rgb565, rgb888, len);
+        for (k = 0; k < len * 3; k++)
+            dst[i * 3 + k] = (float)rgb888[k] * (1.0f / 256.0f) - 0.5f;
+    }
+}
+
+static PyObject *py_kneron_preprocess(PyObject *self, PyObject *args)
+{
+    PyObject *obj;
+    PyArrayObject *src, *dst;
+    npy_intp n;
+
+    if (!PyArg_ParseTuple(args, "O", &obj))
+        return NULL;
+
+    src = as_pixel_array(obj, NPY_UINT8, 2);
+    if (src == NULL)
+        return NULL;
+    if (check_rgb_shape(src) < 0) {
+        Py_DECREF(src);
+        return NULL;
+    }
+
+    dst = (PyArrayObject *)PyArray_SimpleNew(PyArray_NDIM(src), PyArray_DIMS(src), NPY_FLOAT32);
+    if (dst == NULL) {
+        Py_DECREF(src);
+        return NULL;
+    }
+
+    n = PyArray_SIZE(src) / 3;
+    Py_BEGIN_ALLOW_THREADS
+    kneron_preprocess((const uint8_t *)PyArray_DATA(src), (float *)PyArray_DATA(dst), n);
+    Py_END_ALLOW_THREADS
+
+    Py_DECREF(src);
+    return (PyObject *)dst;
+}
+
+/* Build the result tuple: node k is an array of shape (batch, H, C, W), or (H, C, W) if batch < 0.
+ * All arrays view buf, which starts with node 0 for every image, then node 1, ... */
+static PyObject *node_arrays(float *buf, struct raw_output_node_s *nodes, int output_num, npy_intp batch)
+{
+    PyObject *owner, *tuple, *arr;
+    npy_intp dims[4];
+    float *data = buf;
+    int k;
+
+    owner = host_buffer_new(buf);
+    if (owner == NULL)
+        return NULL;
+
+    tuple = PyTuple_New(output_num);
+    if (tuple == NULL) {
+        Py_DECREF(owner);
+        return NULL;
+    }
+
+    for (k = 0; k < output_num; k++) {
+        int nd = 0;
+
+        if (batch >= 0)
+            dims[nd++] = batch;
+        dims[nd++] = nodes[k].height;
+        dims[nd++] = nodes[k].channel;
+        dims[nd++] = nodes[k].width;
+
+        arr = host_buffer_array(owner, nd, dims, NPY_FLOAT32, data);
+        if (arr == NULL) {
+            Py_DECREF(tuple);
+            Py_DECREF(owner);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(tuple, k, arr);
+        data += (batch >= 0 ? batch : 1) * raw_output_node_len(&nodes[k]);
+    }
+
+    Py_DECREF(owner);
+    return tuple;
+}
+
+static PyObject *py_dequantize(PyObject *self, PyObject *args)
+{
+    struct raw_output_node_s nodes[RAW_OUTPUT_NODE_MAX];
+    Py_buffer raw;
+    size_t total = 0;
+    float *buf, *dst;
+    int output_num, k;
+
+    if (!PyArg_ParseTuple(args, "y*", &raw))
+        return NULL;
+
+    output_num = raw_output_parse((const char *)raw.buf, (uint32_t)raw.len, nodes, RAW_OUTPUT_NODE_MAX);
+    if (output_num < 0) {
+        PyBuffer_Release(&raw);
+        PyErr_SetString(PyExc_ValueError, "malformed raw output buffer");
+        return NULL;
+    }
+
+    for (k = 0; k < output_num; k++)
+        total += raw_output_node_len(&nodes[k]);
+
+    buf = (float *)malloc(total * sizeof(float) + 1);
+    if (buf == NULL) {
+        PyBuffer_Release(&raw);
+        return PyErr_NoMemory();
+    }
+
+    dst = buf;
+    for (k = 0; k < output_num; k++) {
+        raw_output_dequant(&nodes[k], dst);
+        dst += raw_output_node_len(&nodes[k]);
+    }
+    PyBuffer_Release(&raw);
+
+    return node_arrays(buf, nodes, output_num, -1);
+}
+
+#ifdef KL520PY_WITH_HOST_LIB
+
+#define KL520PY_DEV_MAX         8
+#define KL520PY_RES_SIZE        (256 * 1024)
+
+static int lib_started = 0;
+
+/* input size configured by load_model(), by dev_idx; 0 until a model is loaded */
+static struct {
+    int width;
+    int height;
+} dev_input[KL520PY_DEV_MAX];
+
+static PyObject *py_open_devices(PyObject *self, PyObject *args)
+{
+    kdp_device_info_list_t *list = NULL;
+    PyObject *dev_list, *item;
+    int count = 1, i, dev_idx;
+
+    if (!PyArg_ParseTuple(args, "|i", &count))
+        return NULL;
+    if (lib_started) {
+        PyErr_SetString(PyExc_RuntimeError, "devices already opened, call close() first");
+        return NULL;
+    }
+    if (count <= 0 || count > KL520PY_DEV_MAX) {
+        PyErr_Format(PyExc_ValueError, "count must be 1..%d", KL520PY_DEV_MAX);
+        return NULL;
+    }
+
+    if (kdp_lib_init() < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "kdp_lib_init() failed");
+        return NULL;
+    }
+
+    kdp_scan_usb_devices(&list);
+    if (list == NULL || list->num_dev < count) {
+        kdp_lib_de_init();
+        PyErr_Format(PyExc_RuntimeError, "found %d KL520 device(s), need %d", list ? list->num_dev : 0, count);
+        return NULL;
+    }
+
+    dev_list = PyList_New(0);
+    if (dev_list == NULL) {
+        kdp_lib_de_init();
+        return NULL;
+    }
+
+    for (i = 0; i < count; i++) {
+        dev_idx = kdp_connect_usb_device(list->kdevice[i].scan_index);
+        if (dev_idx < 0) {
+            Py_DECREF(dev_list);
+            kdp_lib_de_init();
+            PyErr_Format(PyExc_RuntimeError, "could not connect device with scan index %d", list->kdevice[i].scan_index);
+            return NULL;
+        }
+        item = PyLong_FromLong(dev_idx);
+        if (item == NULL || PyList_Append(dev_list, item) < 0) {
+            Py_XDECREF(item);
+            Py_DECREF(dev_list);
+            kdp_lib_de_init();
+            return NULL;
+        }
+        Py_DECREF(item);
+    }
+
+    if (kdp_lib_start() < 0) {
+        Py_DECREF(dev_list);
+        kdp_lib_de_init();
+        PyErr_SetString(PyExc_RuntimeError, "kdp_lib_start() failed");
+        return NULL;
+    }
+
+    lib_started = 1;
+    return dev_list;
+}
+
+static PyObject *py_close(PyObject *self, PyObject *args)
+{
+    if (lib_started) {
+        kdp_lib_de_init();
+        lib_started = 0;
+    }
+    memset(dev_input, 0, sizeof(dev_input));
+    Py_RETURN_NONE;
+}
+
+static PyObject *py_load_model(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static char *kwlist[] = {"dev_idx", "nef_path", "model_id", "output_num", "width", "height", NULL};
+    struct kdp_dme_cfg_s dme_cfg;
+    const char *nef_path;
+    int dev_idx, model_id = 1, output_num = 1, width = 224, height = 224;
+    uint32_t ret_size = 0, ret_model_id = 0;
+    char *model_buf;
+    long model_size;
+    FILE *fp;
+    int ret;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "is|iiii", kwlist,
+                                     &dev_idx, &nef_path, &model_id, &output_num, &width, &height))
+        return NULL;
+    if (dev_idx < 0 || dev_idx >= KL520PY_DEV_MAX) {
+        PyErr_Format(PyExc_ValueError, "dev_idx must be 0..%d", KL520PY_DEV_MAX - 1);
+        return NULL;
+    }
+
+    fp = fopen(nef_path, "rb");
+    if (fp == NULL)
+        return PyErr_SetFromErrnoWithFilename(PyExc_OSError, nef_path);
+    fseek(fp, 0, SEEK_END);
+    model_size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    model_buf = (char *)malloc(model_size);
+    if (model_buf == NULL || fread(model_buf, 1, model_size, fp) != (size_t)model_size) {
+        fclose(fp);
+        free(model_buf);
+        PyErr_Format(PyExc_OSError, "could not read '%s'", nef_path);
+        return NULL;
+    }
+    fclose(fp);
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = kdp_start_dme_ext(dev_idx, model_buf, model_size, &ret_size);
+    Py_END_ALLOW_THREADS
+    free(model_buf);
+    if (ret != 0) {
+        PyErr_Format(PyExc_RuntimeError, "could not set to DME mode: %d", ret);
+        return NULL;
+    }
+
+    memset(&dme_cfg, 0, sizeof(dme_cfg));
+    dme_cfg.model_id     = model_id;
+    dme_cfg.output_num   = output_num;
+    dme_cfg.image_col    = width;
+    dme_cfg.image_row    = height;
+    dme_cfg.image_ch     = 3;
+    dme_cfg.image_format = IMAGE_FORMAT_SUB128 | NPU_FORMAT_RGB565 | IMAGE_FORMAT_RAW_OUTPUT;
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = kdp_dme_configure(dev_idx, (char *)&dme_cfg, sizeof(dme_cfg), &ret_model_id);
+    Py_END_ALLOW_THREADS
+    if (ret != 0) {
+        PyErr_Format(PyExc_RuntimeError, "could not set to DME configure mode: %d", ret);
+        return NULL;
+    }
+
+    dev_input[dev_idx].width = width;
+    dev_input[dev_idx].height = height;
+    return PyLong_FromUnsignedLong(ret_model_id);
+}
+
+/* Run every image through kdp_dme_inference() and dequantize straight into the result block */
+static int infer_batch(int dev_idx, int model_id, const uint8_t *images, npy_intp batch, npy_intp pixels,
+                       float **out_buf, struct raw_output_node_s *nodes, int *output_num, char *err, size_t err_len)
+{
+    struct raw_output_node_s cur[RAW_OUTPUT_NODE_MAX];
+    size_t node_off[RAW_OUTPUT_NODE_MAX];
+    uint16_t *img565 = NULL;
+    char *inf_res = NULL;
+    float *buf = NULL;
+    size_t total = 0;
+    npy_intp i;
+    int k, n, ret = -1;
+
+    img565 = (uint16_t *)malloc(pixels * sizeof(uint16_t));
+    inf_res = (char *)malloc(KL520PY_RES_SIZE);
+    if (img565 == NULL || inf_res == NULL) {
+        snprintf(err, err_len, "out of memory");
+        goto out;
+    }
+
+    for (i = 0; i < batch; i++) {
+        uint32_t inf_size = 0;
+        bool res_flag = true;
+
+        rgb888_to_rgb565(images + i * pixels * 3, img565, pixels);
+
+        if (kdp_dme_inference(dev_idx, (char *)img565, pixels * 2, &inf_size, &res_flag, inf_res, 0, model_id) != 0) {
+            snprintf(err, err_len, "kdp_dme_inference failed on image %ld", (long)i);
+            goto out;
+        }
+        if (inf_size > KL520PY_RES_SIZE || kdp_dme_retrieve_res(dev_idx, 0, inf_size, inf_res) != 0) {
+            snprintf(err, err_len, "kdp_dme_retrieve_res failed on image %ld", (long)i);
+            goto out;
+        }
+
+        n = raw_output_parse(inf_res, inf_size, cur, RAW_OUTPUT_NODE_MAX);
+        if (n < 0) {
+            snprintf(err, err_len, "malformed raw output for image %ld", (long)i);
+            goto out;
+        }
+
+        if (buf == NULL) {
+            /* layout is fixed by the model, so size the whole block from the first image */
+            for (k = 0; k < n; k++) {
+                nodes[k] = cur[k];
+                node_off[k] = total;
+                total += batch * raw_output_node_len(&cur[k]);
+            }
+            *output_num = n;
+            buf = (float *)malloc(total * sizeof(float) + 1);
+            if (buf == NULL) {
+                snprintf(err, err_len, "out of memory");
+                goto out;
+            }
+        } else if (n != *output_num) {
+            snprintf(err, err_len, "output node count changed on image %ld", (long)i);
+            goto out;
+        }
+
+        for (k = 0; k < n; k++) {
+            int len = raw_output_node_len(&cur[k]);
+
+            if (len != raw_output_node_len(&nodes[k])) {
+                snprintf(err, err_len, "output node %d shape changed on image %ld", k, (long)i);
+                goto out;
+            }
+            raw_output_dequant(&cur[k], buf + node_off[k] + i * len);
+        }
+    }
+
+    *out_buf = buf;
+    buf = NULL;
+    ret = 0;
+
+out:
+    free(buf);
+    free(inf_res);
+    free(img565);
+    return ret;
+}
+
+static PyObject *py_infer_batch(PyObject *self, PyObject *args)
+{
+    struct raw_output_node_s nodes[RAW_OUTPUT_NODE_MAX];
+    PyArrayObject *images;
+    PyObject *obj;
+    float *buf = NULL;
+    char err[128];
+    int dev_idx, model_id, output_num = 0, ret;
+    npy_intp batch, pixels;
+
+    if (!PyArg_ParseTuple(args, "iiO", &dev_idx, &model_id, &obj))
+        return NULL;
+
+    images = as_pixel_array(obj, NPY_UINT8, 4);
+    if (images == NULL)
+        return NULL;
+    if (PyArray_NDIM(images) != 4 || check_rgb_shape(images) < 0) {
+        if (!PyErr_Occurred())
+            PyErr_SetString(PyExc_ValueError, "images must be (N, H, W, 3) uint8 RGB");
+        Py_DECREF(images);
+        return NULL;
+    }
+
+    if (dev_idx < 0 || dev_idx >= KL520PY_DEV_MAX || dev_input[dev_idx].width == 0) {
+        PyErr_Format(PyExc_RuntimeError, "no model loaded on device %d, call load_model() first", dev_idx);
+        Py_DECREF(images);
+        return NULL;
+    }
+    if (PyArray_DIM(images, 1) != dev_input[dev_idx].height || PyArray_DIM(images, 2) != dev_input[dev_idx].width) {
+        PyErr_Format(PyExc_ValueError, "images are %ldx%ld, the model on device %d takes %dx%d",
+                     (long)PyArray_DIM(images, 2), (long)PyArray_DIM(images, 1), dev_idx,
+                     dev_input[dev_idx].width, dev_input[dev_idx].height);
+        Py_DECREF(images);
+        return NULL;
+    }
+
+    batch = PyArray_DIM(images, 0);
+    pixels = PyArray_DIM(images, 1) * PyArray_DIM(images, 2);
+    if (batch == 0) {
+        Py_DECREF(images);
+        return PyTuple_New(0);
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = infer_batch(dev_idx, model_id, (const uint8_t *)PyArray_DATA(images), batch, pixels,
+                      &buf, nodes, &output_num, err, sizeof(err));
+    Py_END_ALLOW_THREADS
+
+    Py_DECREF(images);
+    if (ret != 0) {
+        PyErr_SetString(PyExc_RuntimeError, err);
+        return NULL;
+    }
+
+    return node_arrays(buf, nodes, output_num, batch);
+}
+
+static PyObject *py_end_dme(PyObject *self, PyObject *args)
+{
+    int dev_idx;
+
+    if (!PyArg_ParseTuple(args, "i", &dev_idx))
+        return NULL;
+
+    kdp_end_dme(dev_idx);
+    Py_RETURN_NONE;
+}
+
+#endif /* KL520PY_WITH_HOST_LIB */
+
+static PyMethodDef kl520py_methods[] = {
+    {"rgb888_to_rgb565", py_rgb888_to_rgb565, METH_VARARGS,
+     "rgb888_to_rgb565(img) -> uint16 array, img is uint8 (..., 3) RGB"},
+    {"rgb565_to_rgb888", py_rgb565_to_rgb888, METH_VARARGS,
+     "rgb565_to_rgb888(img565) -> uint8 array (..., 3) RGB"},
+    {"kneron_preprocess", py_kneron_preprocess, METH_VARARGS,
+     "kneron_preprocess(img) -> float32 array, RGB565 round trip then x / 256 - 0.5"},
+    {"dequantize", py_dequantize, METH_VARARGS,
+     "dequantize(raw) -> tuple of float32 (H, C, W) arrays, raw is a kdp_dme_retrieve_res() buffer"},
+#ifdef KL520PY_WITH_HOST_LIB
+    {"open_devices", py_open_devices, METH_VARARGS,
+     "open_devices(count=1) -> list of dev_idx"},
+    {"close", py_close, METH_NOARGS,
+     "close() -> None, de-initialize the host lib"},
+    {"load_model", (PyCFunction)(void (*)(void))py_load_model, METH_VARARGS | METH_KEYWORDS,
+     "load_model(dev_idx, nef_path, model_id=1, output_num=1, width=224, height=224) -> configured model id"},
+    {"infer_batch", py_infer_batch, METH_VARARGS,
+     "infer_batch(dev_idx, model_id, images) -> tuple of float32 (N, H, C, W) arrays, images is uint8 (N, H, W, 3) RGB"},
+    {"end_dme", py_end_dme, METH_VARARGS,
+     "end_dme(dev_idx) -> None"},
+#endif
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef kl520py_module = {
+    PyModuleDef_HEAD_INIT, "kl520py", "KL520 host pipeline bindings", -1, kl520py_methods
+};
+
+PyMODINIT_FUNC PyInit_kl520py(void)
+{
+    PyObject *m;
+
+    import_array();
+
+    m = PyModule_Create(&kl520py_module);
+    if (m == NULL)
+        return NULL;
+
+    PyModule_AddStringConstant(m, "ISA", rgb565_codec_isa());
+#ifdef KL520PY_WITH_HOST_LIB
+    PyModule_AddIntConstant(m, "HAS_HOST_LIB", 1);
+#else
+    PyModule_AddIntConstant(m, "HAS_HOST_LIB", 0);
+#endif
+    return m;
+}
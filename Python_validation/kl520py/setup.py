@@ -0,0 +1,57 @@
+# Build the kl520py extension in place:
+#
+#   python setup.py build_ext --inplace
+#
+# Without HOST_LIB_DIR only the host-side kernels (RGB565 codec, kneron preprocessing,
+# dequantization) are built. Point HOST_LIB_DIR at the unpacked host_lib (with its build/
+# directory already made) to also get open_devices / load_model / infer_batch.
+
+import os
+import platform
+
+import numpy
+from setuptools import Extension, setup
+
+here = os.path.dirname(os.path.abspath(__file__))
+example_dir = os.path.normpath(os.path.join(here, '..', '..', 'KL_520_example'))
+
+sources = [
+    'kl520py.c',
+    os.path.join(example_dir, 'rgb565_codec.c'),
+    os.path.join(example_dir, 'raw_output.c'),
+]
+include_dirs = [numpy.get_include(), example_dir]
+define_macros = []
+library_dirs = []
+libraries = []
+extra_compile_args = ['-O3']
+
+if platform.machine() in ('x86_64', 'AMD64', 'i686'):
+    extra_compile_args.append('-mssse3')
+
+host_lib_dir = os.environ.get('HOST_LIB_DIR')
+if host_lib_dir:
+    define_macros.append(('KL520PY_WITH_HOST_LIB', '1'))
+    include_dirs += [
+        os.path.join(host_lib_dir, 'include'),
+        os.path.join(host_lib_dir, 'common', 'include'),
+    ]
+    library_dirs.append(os.environ.get('HOST_LIB_BUILD_DIR', os.path.join(host_lib_dir, 'build', 'src')))
+    libraries += ['hostkdp', 'usb-1.0', 'pthread']
+
+setup(
+    name='kl520py',
+    version='0.1',
+    description='KL520 host pipeline bindings',
+    ext_modules=[
+        Extension(
+            'kl520py',
+            sources=sources,
+            include_dirs=include_dirs,
+            define_macros=define_macros,
+            library_dirs=library_dirs,
+            libraries=libraries,
+            extra_compile_args=extra_compile_args,
+        )
+    ],
+)
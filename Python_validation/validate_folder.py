@@ -0,0 +1,84 @@
+"""Compare KL520 inference against the keras reference model over a whole image folder.
+
+    python validate_folder.py --images ../data1/model01/images --model model01.h5 \
+        --nef ~/Desktop/host_lib/input_models/KL520/test_model/models_520.nef
+
+Images are resized to 224x224 once and fed to both sides. The keras side goes through the same
+RGB565 round trip and "kneron" preprocessing the NPU applies (see Main.ipynb). Without --nef (or
+with a kl520py built without HOST_LIB_DIR) only the keras reference is run.
+"""
+
+import argparse
+import os
+import time
+
+import cv2
+import numpy as np
+
+import kl520py
+
+IMG_EXTS = ('.bmp', '.jpg', '.jpeg', '.png')
+
+
+def load_folder(folder, size):
+    names = sorted(f for f in os.listdir(folder) if f.lower().endswith(IMG_EXTS))
+    batch = np.empty((len(names), size[1], size[0], 3), dtype=np.uint8)
+    for i, name in enumerate(names):
+        im = cv2.imread(os.path.join(folder, name))
+        if im.shape[1] != size[0] or im.shape[0] != size[1]:
+            im = cv2.resize(im, size, interpolation=cv2.INTER_LINEAR)
+        cv2.cvtColor(im, cv2.COLOR_BGR2RGB, dst=batch[i])
+    return names, batch
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--images', default='../data1/model01/images')
+    parser.add_argument('--model', default='model01.h5')
+    parser.add_argument('--nef', default=None, help='models_520.nef, enables the KL520 side')
+    parser.add_argument('--model-id', type=int, default=1, help='model id when compiling in toolchain')
+    parser.add_argument('--batch-size', type=int, default=32)
+    parser.add_argument('--atol', type=float, default=0.5, help='max abs difference counted as a match')
+    args = parser.parse_args()
+
+    t0 = time.time()
+    names, images = load_folder(args.images, (224, 224))
+    print('loaded %d images in %.2fs (rgb565 kernels: %s)' % (len(names), time.time() - t0, kl520py.ISA))
+
+    from keras.models import load_model
+    model = load_model(args.model)
+
+    t0 = time.time()
+    ref = model.predict(kl520py.kneron_preprocess(images), batch_size=args.batch_size)
+    ref = ref.reshape(len(names), -1)
+    print('keras reference: %.2fs' % (time.time() - t0))
+
+    if args.nef is None or not kl520py.HAS_HOST_LIB:
+        print('no KL520 side requested/available, done')
+        return
+
+    dev_idx = kl520py.open_devices(1)[0]
+    try:
+        model_id = kl520py.load_model(dev_idx, args.nef, model_id=args.model_id)
+        t0 = time.time()
+        out = kl520py.infer_batch(dev_idx, model_id, images)[0]
+        print('KL520: %.2fs' % (time.time() - t0))
+        kl520py.end_dme(dev_idx)
+    finally:
+        kl520py.close()
+
+    # (N, H, C, W) -> (N, H*W*C) in the same order keras flattens NHWC
+    dev = out.transpose(0, 1, 3, 2).reshape(len(names), -1)
+
+    diff = np.abs(dev - ref)
+    top1 = dev.argmax(axis=1) == ref.argmax(axis=1)
+    print('max abs diff %.4f, mean abs diff %.4f' % (diff.max(), diff.mean()))
+    print('top-1 agreement %d/%d, within atol %d/%d' % (
+        top1.sum(), len(names), (diff.max(axis=1) <= args.atol).sum(), len(names)))
+    for i in np.argsort(-diff.max(axis=1))[:5]:
+        print('  %s: max abs diff %.4f, top-1 kl520 %d / keras %d' % (
+            names[i], diff[i].max(), dev[i].argmax(), ref[i].argmax()))
+
+
+if __name__ == '__main__':
+    main()